@@ -0,0 +1,110 @@
+#include "Benchmark.hpp"
+#include "system/Allocations.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+volatile size_t Benchmark::_sink = 0;
+
+Benchmark::Benchmark(double minTime, const std::string & filter) : _minTime(minTime), _filter(filter) {
+}
+
+void Benchmark::run(const std::string & name, size_t items, size_t bytes, const std::function<void()> & function){
+	if(!_filter.empty() && name.find(_filter) == std::string::npos){
+		return;
+	}
+	Result result;
+	result.name = name;
+	result.items = items;
+	result.bytes = bytes;
+	result.min = std::numeric_limits<double>::max();
+
+	result.allocations = std::numeric_limits<size_t>::max();
+
+	double total = 0.0;
+	while(result.iterations == 0 || total < _minTime){
+		const Allocations::Counters allocations = Allocations::current();
+		const auto start = std::chrono::steady_clock::now();
+		function();
+		const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+		const Allocations::Counters allocationsEnd = Allocations::current();
+		if(allocationsEnd.count - allocations.count < result.allocations){
+			result.allocations = allocationsEnd.count - allocations.count;
+			result.allocated = allocationsEnd.bytes - allocations.bytes;
+		}
+		result.min = std::min(result.min, duration.count());
+		total += duration.count();
+		++result.iterations;
+	}
+	result.mean = total / double(result.iterations);
+
+	std::stringstream line;
+	line << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(3)
+		<< std::setw(12) << result.min * 1000.0 << " ms (min) " << std::setw(12) << result.mean * 1000.0 << " ms (mean) "
+		<< std::setw(8) << result.iterations << " it.";
+	if(items != 0){
+		line << std::setw(10) << std::setprecision(1) << double(items) / result.min * 1e-6 << " Mitems/s";
+	}
+	if(Allocations::enabled()){
+		line << std::setw(10) << result.allocations << " allocs";
+	}
+	Log::Info() << line.str() << std::endl;
+	_results.push_back(result);
+}
+
+void Benchmark::budget(const std::string & name, double allocationsPerItem){
+	_budgets[name] = allocationsPerItem;
+}
+
+bool Benchmark::checkBudgets() const {
+	if(!Allocations::enabled()){
+		return true;
+	}
+	bool success = true;
+	for(const Result & result : _results){
+		const auto budget = _budgets.find(result.name);
+		if(budget == _budgets.end()){
+			continue;
+		}
+		const double perItem = double(result.allocations) / double(std::max(result.items, size_t(1)));
+		if(perItem > budget->second){
+			Log::Error() << result.name << ": " << perItem << " allocations per item, over the budget of " << budget->second << "." << std::endl;
+			success = false;
+		}
+	}
+	return success;
+}
+
+void Benchmark::describe(const std::string & key, const std::string & value){
+	_context.emplace_back(key, value);
+}
+
+bool Benchmark::save(const fs::path & path) const {
+	std::ofstream file(path);
+	if(!file.is_open()){
+		Log::Error() << "Unable to write results to " << path << "." << std::endl;
+		return false;
+	}
+	// Names and values are generated by the benchmark, without characters to escape.
+	file << "{\n\t\"context\": {";
+	for(size_t cid = 0; cid < _context.size(); ++cid){
+		file << (cid == 0 ? "\n" : ",\n") << "\t\t\"" << _context[cid].first << "\": \"" << _context[cid].second << "\"";
+	}
+	file << "\n\t},\n\t\"benchmarks\": [";
+	file << std::setprecision(9);
+	for(size_t rid = 0; rid < _results.size(); ++rid){
+		const Result & result = _results[rid];
+		file << (rid == 0 ? "\n" : ",\n") << "\t\t{\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+			<< ", \"min\": " << result.min << ", \"mean\": " << result.mean
+			<< ", \"items\": " << result.items << ", \"bytes\": " << result.bytes;
+		if(Allocations::enabled()){
+			file << ", \"allocations\": " << result.allocations << ", \"allocated\": " << result.allocated;
+		}
+		file << "}";
+	}
+	file << "\n\t]\n}\n";
+	return bool(file);
+}
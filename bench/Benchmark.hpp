@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Common.hpp"
+#include "system/System.hpp"
+
+#include <functional>
+#include <map>
+
+/**
+ \brief Time functions repeatedly and collect the results, to be saved as JSON.
+ When built with allocation counting, heap allocations are also measured and can be checked against budgets.
+ */
+class Benchmark {
+public:
+
+	/// \brief Measurements of a benchmark.
+	struct Result {
+		std::string name;
+		size_t iterations = 0;
+		double min = 0.0; ///< Fastest iteration, in seconds.
+		double mean = 0.0; ///< Average iteration, in seconds.
+		size_t items = 0; ///< Items processed per iteration.
+		size_t bytes = 0; ///< Bytes processed per iteration.
+		size_t allocations = 0; ///< Fewest allocations in an iteration.
+		size_t allocated = 0; ///< Bytes allocated in the same iteration.
+	};
+
+	/** Constructor.
+	 \param minTime minimum time to spend in each benchmark, in seconds
+	 \param filter only run benchmarks whose name contains this text
+	 */
+	Benchmark(double minTime, const std::string & filter);
+
+	/** Time a function, at least once and until the minimum time is elapsed.
+	 \param name the benchmark name
+	 \param items the number of items processed by each call
+	 \param bytes the number of bytes processed by each call
+	 \param function the function to time
+	 */
+	void run(const std::string & name, size_t items, size_t bytes, const std::function<void()> & function);
+
+	/** Set the maximum number of allocations per processed item for a benchmark.
+	 \param name the benchmark name
+	 \param allocationsPerItem the maximum number of allocations per item
+	 */
+	void budget(const std::string & name, double allocationsPerItem);
+
+	/** Check the allocations of all benchmarks run against their budgets, if allocations are counted.
+	 \return false if a budget was exceeded
+	 */
+	bool checkBudgets() const;
+
+	/** Add information about the run, saved along the results.
+	 \param key the property name
+	 \param value the property value
+	 */
+	void describe(const std::string & key, const std::string & value);
+
+	/** Save all results.
+	 \param path the JSON file to write
+	 \return true if the file was written
+	 */
+	bool save(const fs::path & path) const;
+
+	/** Prevent the compiler from discarding a computed value.
+	 \param value the value to keep
+	 */
+	template<typename T>
+	static void keep(const T & value) {
+		_sink = _sink + size_t(value);
+	}
+
+private:
+
+	std::vector<Result> _results;
+	std::map<std::string, double> _budgets; ///< Maximum allocations per item.
+	std::vector<std::pair<std::string, std::string>> _context;
+	const double _minTime;
+	const std::string _filter;
+
+	static volatile size_t _sink;
+};
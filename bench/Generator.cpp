@@ -0,0 +1,106 @@
+#include "Generator.hpp"
+#include "Operation.hpp"
+
+#include <fstream>
+#include <cmath>
+
+namespace {
+
+	const std::vector<std::string> merchants = {
+		"carrefour", "monoprix", "sncf", "amazon", "fnac", "boulangerie", "pharmacie", "cinema", "restaurant", "librairie",
+		"station", "garage", "primeur", "fromagerie", "epicerie", "pressing", "coiffeur", "marche", "bricolage", "jardinerie"
+	};
+
+	const std::vector<std::string> places = {
+		"paris", "lyon", "marseille", "lille", "nantes", "rennes", "bordeaux", "toulouse", "nice", "grenoble",
+		"strasbourg", "dijon", "angers", "tours", "brest", "metz", "nancy", "caen", "rouen", "pau"
+	};
+
+	const std::vector<std::string> tags = {"", "", "", "", " #food", " #travel", " #home", " #gift"};
+}
+
+Generator::Generator(const Settings & settings) : _settings(settings), _state(settings.seed) {
+	_settings.operations = std::max(_settings.operations, size_t(1));
+	_settings.vocabulary = std::max(_settings.vocabulary, size_t(1));
+	_settings.years		 = std::max(_settings.years, 1);
+
+	// Build the vocabulary from merchants, places and a store number when needed.
+	_labels.reserve(_settings.vocabulary);
+	for(size_t lid = 0; lid < _settings.vocabulary; ++lid){
+		std::string label = merchants[lid % merchants.size()] + " " + places[(lid / merchants.size()) % places.size()];
+		const size_t store = lid / (merchants.size() * places.size());
+		if(store != 0){
+			label += " " + std::to_string(store);
+		}
+		label += tags[random() % tags.size()];
+		_labels.push_back(label);
+	}
+
+	_dayCount = long(_settings.years) * 365;
+	_firstDay = _settings.last.dayNumber() - _dayCount + 1;
+}
+
+uint64_t Generator::random(){
+	uint64_t z = (_state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+double Generator::uniform(){
+	return double(random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void Generator::next(std::string & dst){
+	if(uniform() < _settings.comments){
+		dst.append("# Statement ");
+		dst.append(std::to_string(_index));
+		dst.push_back('\n');
+	}
+	// Operations are in chronological order, evenly spread.
+	const long day = _firstDay + long((unsigned long long)(_index) * (unsigned long long)(_dayCount) / _settings.operations);
+	char buffer[16];
+	const size_t size = Date::fromDayNumber(day).write(Date::Format::YearMonthDay, buffer);
+	dst.append(buffer, size);
+	dst.push_back('\t');
+
+	// Amounts follow a log-uniform distribution, from 1.00 to 10000.00.
+	const bool income = uniform() < _settings.incomes;
+	const Amount amount = Amount(std::pow(10.0, 2.0 + 4.0 * uniform()));
+	dst.append(Operation::writeAmount(income ? amount : -amount, true));
+	dst.push_back('\t');
+
+	// Favor some labels, as in real listings.
+	const double pick = uniform();
+	dst.append(_labels[size_t(pick * pick * double(_labels.size()))]);
+	dst.push_back('\n');
+	++_index;
+}
+
+bool Generator::write(const fs::path & path){
+	std::ofstream file(path, std::ios::binary);
+	if(!file.is_open()){
+		Log::Error() << "Unable to write listing to " << path << "." << std::endl;
+		return false;
+	}
+	std::string block;
+	block.reserve(1 << 20);
+	while(_index < _settings.operations){
+		next(block);
+		if(block.size() > (1 << 20) - 256){
+			file.write(block.data(), std::streamsize(block.size()));
+			block.clear();
+		}
+	}
+	file.write(block.data(), std::streamsize(block.size()));
+	return bool(file);
+}
+
+std::string Generator::generate(){
+	std::string content;
+	content.reserve(_settings.operations * 40);
+	while(_index < _settings.operations){
+		next(content);
+	}
+	return content;
+}
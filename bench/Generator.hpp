@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Common.hpp"
+#include "Date.hpp"
+#include "system/System.hpp"
+
+#include <cstdint>
+
+/**
+ \brief Generate synthetic listings, identical on all platforms for the same settings.
+ Operations are spread evenly over the date span, with labels drawn from a fixed vocabulary.
+ */
+class Generator {
+public:
+
+	/// \brief Generated listing characteristics.
+	struct Settings {
+		size_t operations = 100000; ///< Number of operations.
+		size_t vocabulary = 1000; ///< Number of distinct labels.
+		int years = 10; ///< Date span, ending on the last day.
+		Date last = Date(2024, 12, 31); ///< Date of the last operation.
+		double comments = 0.001; ///< Probability of a comment line before each operation.
+		double incomes = 0.05; ///< Probability of an operation being an income.
+		uint64_t seed = 0x5EED; ///< Random seed.
+	};
+
+	/** Constructor.
+	 \param settings the listing characteristics
+	 */
+	explicit Generator(const Settings & settings);
+
+	/** Write the whole listing to a file, by blocks.
+	 \param path the destination file
+	 \return true if the file was written
+	 */
+	bool write(const fs::path & path);
+
+	/** Generate the whole listing in memory.
+	 \return the listing content
+	 */
+	std::string generate();
+
+private:
+
+	/** Append the next line(s) to a string.
+	 \param dst the string to append to
+	 */
+	void next(std::string & dst);
+
+	/** \return the next random number (splitmix64) */
+	uint64_t random();
+
+	/** \return a random number in [0,1) */
+	double uniform();
+
+	Settings _settings;
+	std::vector<std::string> _labels; ///< The label vocabulary.
+	long _firstDay; ///< Day number of the first operation.
+	long _dayCount; ///< Number of days in the span.
+	size_t _index = 0; ///< Index of the next operation.
+	uint64_t _state; ///< Random state.
+};
@@ -0,0 +1,209 @@
+#include "Common.hpp"
+#include "Listing.hpp"
+#include "Printer.hpp"
+#include "Grapher.hpp"
+#include "Generator.hpp"
+#include "Benchmark.hpp"
+
+#include "system/Config.hpp"
+#include "system/System.hpp"
+#include "system/TextUtilities.hpp"
+#include "system/Terminal.hpp"
+
+class BenchConfig : public Config {
+public:
+
+	explicit BenchConfig(const std::vector<std::string> & argv) : Config(argv) {
+		for(const auto & arg : arguments()) {
+			if(arg.values.empty()){
+				continue;
+			}
+			if(arg.key == "operations") {
+				generator.operations = std::stoull(arg.values[0]);
+			}
+			if(arg.key == "vocabulary") {
+				generator.vocabulary = std::stoull(arg.values[0]);
+			}
+			if(arg.key == "years") {
+				generator.years = std::stoi(arg.values[0]);
+			}
+			if(arg.key == "comments") {
+				generator.comments = std::stod(arg.values[0]);
+			}
+			if(arg.key == "seed") {
+				generator.seed = std::stoull(arg.values[0]);
+			}
+			if(arg.key == "generate") {
+				generatePath = arg.values[0];
+			}
+			if(arg.key == "output") {
+				outputPath = arg.values[0];
+			}
+			if(arg.key == "filter") {
+				filter = arg.values[0];
+			}
+			if(arg.key == "min-time") {
+				minTime = std::stod(arg.values[0]);
+			}
+		}
+
+		registerSection("Listing");
+		registerArgument("operations", "", "Number of generated operations (100000 by default)", "n");
+		registerArgument("vocabulary", "", "Number of distinct labels (1000 by default)", "n");
+		registerArgument("years", "", "Number of years covered, ending on 2024/12/31 (10 by default)", "n");
+		registerArgument("comments", "", "Probability of a comment line before each operation (0.001 by default)", "ratio");
+		registerArgument("seed", "", "Random seed", "n");
+		registerArgument("generate", "", "Only write the generated listing to a file", "path");
+
+		registerSection("Benchmarks");
+		registerArgument("output", "", "Write the results to a JSON file", "path");
+		registerArgument("filter", "", "Only run benchmarks whose name contains a text", "text");
+		registerArgument("min-time", "", "Minimum time spent in each benchmark, in seconds (0.5 by default)", "seconds");
+	}
+
+	Generator::Settings generator;
+	std::string generatePath;
+	std::string outputPath;
+	std::string filter;
+	double minTime = 0.5;
+};
+
+int main(int argc, char** argv){
+	setlocale(LC_ALL, "");
+
+	BenchConfig config(std::vector<std::string>(argv, argv+argc));
+	if(config.showHelp(false)){
+		return 0;
+	}
+	if(!config.generatePath.empty()){
+		return Generator(config.generator).write(config.generatePath) ? 0 : 1;
+	}
+	Terminal::disableANSI();
+
+	// Generate the listing once.
+	const std::string content = Generator(config.generator).generate();
+	const size_t opCount = config.generator.operations;
+	const fs::path listingPath = fs::temp_directory_path() / "deben-bench.txt";
+	const fs::path savePath = fs::temp_directory_path() / "deben-bench-saved.txt";
+	if(!System::writeStringToFile(content, listingPath)){
+		return 1;
+	}
+	Log::Info() << "Generated " << opCount << " operations (" << content.size() << " bytes)." << std::endl;
+
+	Benchmark bench(config.minTime, config.filter);
+	// Allocation budgets per operation, checked in builds counting allocations.
+	// Set just above the measured values with the default settings (12.0 and 7.1), to catch regressions.
+	bench.budget("Listing::load", 12.5);
+	bench.budget("Printer::printList", 7.5);
+	bench.describe("operations", std::to_string(opCount));
+	bench.describe("vocabulary", std::to_string(config.generator.vocabulary));
+	bench.describe("years", std::to_string(config.generator.years));
+	bench.describe("comments", std::to_string(config.generator.comments));
+	bench.describe("seed", std::to_string(config.generator.seed));
+
+	// Sample fields from the generated content.
+	std::vector<std::string> dates;
+	std::vector<std::string> amounts;
+	std::vector<std::string> labels;
+	for(const std::string & line : TextUtilities::split(content.substr(0, 1 << 20), "\n", true)){
+		const std::vector<std::string> fields = TextUtilities::split(line, "\t", false);
+		if(line[0] == '#' || fields.size() < 3){
+			continue;
+		}
+		dates.push_back(fields[0]);
+		amounts.push_back(fields[1]);
+		labels.push_back(fields[2]);
+	}
+	std::vector<Amount> values;
+	for(const std::string & amount : amounts){
+		values.push_back(Operation::parseAmount(amount));
+	}
+	size_t amountBytes = 0;
+	for(const std::string & amount : amounts){
+		amountBytes += amount.size();
+	}
+
+	// Conversions.
+	bench.run("Operation::parseAmount", amounts.size(), amountBytes, [&amounts](){
+		for(const std::string & amount : amounts){
+			Benchmark::keep(Operation::parseAmount(amount));
+		}
+	});
+	bench.run("Operation::writeAmount", values.size(), 0, [&values](){
+		for(const Amount & value : values){
+			Benchmark::keep(Operation::writeAmount(value).size());
+		}
+	});
+	bench.run("Date::Date", dates.size(), 0, [&dates](){
+		for(const std::string & date : dates){
+			Benchmark::keep(Date(date).key());
+		}
+	});
+	bench.run("Date::write", dates.size(), 0, [&dates](){
+		const Date date(dates.front());
+		char buffer[16];
+		for(size_t did = 0; did < dates.size(); ++did){
+			Benchmark::keep(date.write(Date::Format::DayMonthYearShort, buffer));
+		}
+	});
+	bench.run("TextUtilities::split", labels.size(), 0, [&labels](){
+		for(const std::string & label : labels){
+			Benchmark::keep(TextUtilities::split(label, " ", true).size());
+		}
+	});
+	bench.run("TextUtilities::count", labels.size(), 0, [&labels](){
+		for(const std::string & label : labels){
+			Benchmark::keep(TextUtilities::count(label));
+		}
+	});
+
+	// Listing.
+	bench.run("Listing::load", opCount, content.size(), [&listingPath](){
+		const Listing list(listingPath);
+		Benchmark::keep(list.count());
+	});
+	Listing list(listingPath);
+	// Cover all months since the first operation.
+	const Date now;
+	const Date & first = list.operation(0).date();
+	const long monthCount = (now.year() - first.year()) * 12 + (now.month() - first.month()) + 1;
+	bench.run("Listing::save", opCount, content.size(), [&list, &savePath](){
+		// Only modified listings are saved, replace the last operation by itself.
+		const Operation last = list.operation(list.count() - 1);
+		list.removeOperation(list.count() - 1);
+		list.addOperation(last);
+		list.save(savePath);
+	});
+	bench.run("Listing::monthTotals", opCount, 0, [&list, monthCount](){
+		Benchmark::keep(list.monthTotals(monthCount).size());
+	});
+
+	// Rendering, captured to skip the terminal.
+	const long listCount = std::min(list.count(), 10000l);
+	const std::vector<Operation> operations = list.operations(listCount);
+	bench.run("Printer::printList", size_t(listCount), 0, [&operations, &list](){
+		std::string output;
+		Terminal::captureOutput(&output);
+		Printer::printList(operations, list.count());
+		Terminal::captureOutput(nullptr);
+		Benchmark::keep(output.size());
+	});
+	const std::vector<Totals> months = list.monthTotals(monthCount);
+	const Totals totals = list.totals();
+	bench.run("Grapher::graphMonths", months.size(), 0, [&months, &totals](){
+		std::string output;
+		Terminal::captureOutput(&output);
+		Grapher::graphMonths(months, totals, 20);
+		Terminal::captureOutput(nullptr);
+		Benchmark::keep(output.size());
+	});
+
+	System::removeItem(listingPath);
+	System::removeItem(savePath);
+
+	const bool withinBudgets = bench.checkBudgets();
+	if(!config.outputPath.empty() && !bench.save(config.outputPath)){
+		return 1;
+	}
+	return withinBudgets ? 0 : 1;
+}
@@ -1,4 +1,3 @@
-
 workspace("Deben")
 	-- Configuration.
 	configurations({ "Release", "Dev"})
@@ -16,35 +15,83 @@ workspace("Deben")
 		defines({ "DEBUG" })
 		symbols("On")
 
+	-- Optional settings.
+	filter("options:no-verbose-logs")
+		defines({ "DEBEN_LOG_VERBOSE=0" })
+
+	filter("options:alloc-stats")
+		defines({ "DEBEN_ALLOC_STATS" })
+
 	filter({})
 	startproject("Deben")
 
+-- Settings shared by all projects.
+function CommonSetup()
+	language("C++")
+	cppdialect("C++17")
+	systemversion("latest")
+	-- Compiler flags
+	filter("toolset:not msc*")
+		buildoptions({ "-Wall", "-Wextra" })
+	filter("toolset:msc*")
+		buildoptions({ "-W3"})
+	filter({})
+	-- Common include dirs
+	-- System headers are used to support angled brackets in Xcode.
+	includedirs({"src/"})
+	sysincludedirs({ "libs/" })
+
+	-- visual studio filters
+	filter("action:vs*")
+		defines({ "_CRT_SECURE_NO_WARNINGS" })
+	-- Memory measurements
+	filter("system:windows")
+		links({ "psapi" })
+	filter({})
+end
+
+	-- Listing engine, also usable by other programs through src/Ledger.hpp.
+	project("libdeben")
+		kind("StaticLib")
+		targetname("deben")
+		CommonSetup()
+
+		files({"src/**", "libs/**"})
+		removefiles({"src/main.cpp"})
+		removefiles({"**.DS_STORE", "**.thumbs"})
+
 	project("Deben")
 		kind("ConsoleApp")
+		CommonSetup()
 
-		language("C++")
-		cppdialect("C++17")
-		systemversion("latest")
-		-- Compiler flags
-		filter("toolset:not msc*")
-			buildoptions({ "-Wall", "-Wextra" })
-		filter("toolset:msc*")
-			buildoptions({ "-W3"})
+		files({"src/main.cpp", "premake5.lua"})
+		links({"libdeben"})
+		filter("system:linux")
+			links({"pthread"})
 		filter({})
-		-- Common include dirs
-		-- System headers are used to support angled brackets in Xcode.
-		includedirs({"src/"})
-		sysincludedirs({ "libs/" })
 
-		-- common files
-		files({"src/**", "libs/**", "premake5.lua"})
+	project("DebenBench")
+		kind("ConsoleApp")
+		CommonSetup()
+		includedirs({"bench/"})
+
+		files({"bench/**"})
 		removefiles({"**.DS_STORE", "**.thumbs"})
-		
-		-- visual studio filters
-		filter("action:vs*")
-			defines({ "_CRT_SECURE_NO_WARNINGS" })  
+		links({"libdeben"})
+		filter("system:linux")
+			links({"pthread"})
 		filter({})
 
+newoption {
+   trigger     = "no-verbose-logs",
+   description = "Compile verbose logs out, their arguments are evaluated but never formatted nor written"
+}
+
+newoption {
+   trigger     = "alloc-stats",
+   description = "Count heap allocations, reported by --profile and checked against budgets by DebenBench"
+}
+
 newaction {
    trigger     = "clean",
    description = "Clean the build directory",
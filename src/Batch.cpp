@@ -0,0 +1,74 @@
+#include "Batch.hpp"
+#include "Command.hpp"
+#include "Printer.hpp"
+#include "system/TextUtilities.hpp"
+#include "system/FileWatcher.hpp"
+
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#include <cstdio>
+#else
+#include <unistd.h>
+#endif
+
+bool Batch::run(const std::string & source, const fs::path & path){
+	std::ifstream file;
+	std::istream * input = &std::cin;
+	if(source != "-"){
+		file.open(source);
+		if(!file.is_open()){
+			Log::Error() << "Unable to read commands from " << source << "." << std::endl;
+			return false;
+		}
+		input = &file;
+	}
+#ifdef _WIN32
+	const bool interactive = source == "-" && _isatty(_fileno(stdin));
+#else
+	const bool interactive = source == "-" && isatty(fileno(stdin));
+#endif
+
+	Listing list(path);
+	FileWatcher watcher(path);
+
+	std::string line;
+	size_t lineId = 0;
+	size_t commandCount = 0;
+	while(std::getline(*input, line)){
+		++lineId;
+		const std::string lineClean = TextUtilities::trim(line, "\t\r ");
+		if(lineClean.empty() || lineClean[0] == '#'){
+			continue;
+		}
+		// Pick up modifications made while waiting for input.
+		if(interactive && watcher.changed()){
+			list.refresh(path);
+		}
+
+		Command command;
+		try {
+			if(!Command::fromTokens(TextUtilities::tokenize(lineClean), command)){
+				Log::Warning() << "Line " << lineId << ": unknown command \"" << lineClean << "\"." << std::endl;
+				continue;
+			}
+			// Only print the totals at the end unless commands are typed.
+			if(!command.run(list, interactive)){
+				Log::Warning() << "Line " << lineId << ": invalid filter in \"" << lineClean << "\"." << std::endl;
+				continue;
+			}
+		} catch(const std::exception &){
+			Log::Warning() << "Line " << lineId << ": invalid command \"" << lineClean << "\"." << std::endl;
+			continue;
+		}
+		++commandCount;
+	}
+
+	const bool saved = list.save(path);
+	Log::Verbose() << "Ran " << commandCount << " commands." << std::endl;
+	if(!interactive){
+		Printer::printTotals(list.totals());
+	}
+	return saved;
+}
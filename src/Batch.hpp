@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Common.hpp"
+#include "system/System.hpp"
+
+/**
+ \brief Run many commands on a listing loaded once, and save it once at the end.
+ */
+class Batch {
+public:
+
+	/** Read commands line by line and apply them to a listing.
+	 Each line contains a command name and its values, as passed on the command line ("add -12.5 'label' 03/02", "delete 4", "list 10", "graph 6", "totals").
+	 When reading from an interactive standard input, external modifications of the listing are loaded between commands.
+	 \param source the file to read commands from, or "-" for the standard input
+	 \param path the listing file
+	 \return false if the commands couldn't be read
+	 */
+	static bool run(const std::string & source, const fs::path & path);
+
+};
@@ -0,0 +1,145 @@
+#include "Categorizer.hpp"
+#include "system/TextUtilities.hpp"
+
+#include <queue>
+
+namespace {
+
+	uchar lower(uchar c){
+		return (c >= 'A' && c <= 'Z') ? uchar(c - 'A' + 'a') : c;
+	}
+
+}
+
+bool Categorizer::load(const fs::path & path){
+	const bool read = System::forEachLine(path, [this](const char * str, size_t size){
+		const std::string line = TextUtilities::trim(std::string(str, size), " ");
+		if(line.empty() || line[0] == '#'){
+			return;
+		}
+		const auto tokens = TextUtilities::split(line, "\t", true);
+		if(tokens.size() < 2){
+			Log::Warning() << Log::Load << "Ignoring rule without category: \"" << line << "\"." << std::endl;
+			return;
+		}
+		addRule(TextUtilities::trim(tokens[0], " "), TextUtilities::trim(tokens[1], " "));
+	});
+	if(!read){
+		Log::Error() << Log::Load << "Unable to read rules from " << path << "." << std::endl;
+		return false;
+	}
+	build();
+	Log::Verbose() << Log::Load << "Loaded " << _rules.size() << " rules from " << path << "." << std::endl;
+	return true;
+}
+
+void Categorizer::addRule(const std::string & text, const std::string & category){
+	if(text.empty() || category.empty()){
+		return;
+	}
+	const auto existing = std::find(_categories.begin(), _categories.end(), category);
+	const size_t categoryId = size_t(existing - _categories.begin());
+	if(existing == _categories.end()){
+		_categories.push_back(category);
+	}
+	std::string textLow(text);
+	std::transform(textLow.begin(), textLow.end(), textLow.begin(), lower);
+	_rules.push_back({textLow, categoryId});
+}
+
+bool Categorizer::better(int a, int b) const {
+	if(a < 0){
+		return false;
+	}
+	if(b < 0){
+		return true;
+	}
+	const size_t sizeA = _rules[a].text.size();
+	const size_t sizeB = _rules[b].text.size();
+	return sizeA != sizeB ? sizeA > sizeB : a < b;
+}
+
+void Categorizer::build(){
+	// Only bytes used by the rules need their own transitions.
+	_classes.assign(256, 0);
+	_classCount = 1;
+	for(const Rule & rule : _rules){
+		for(const char c : rule.text){
+			uchar & cls = _classes[uchar(c)];
+			if(cls == 0){
+				cls = uchar(_classCount++);
+			}
+		}
+	}
+	// Labels are compared ignoring case.
+	for(int c = 'A'; c <= 'Z'; ++c){
+		_classes[c] = _classes[lower(uchar(c))];
+	}
+
+	// Build the trie, -1 marking missing transitions.
+	_transitions.assign(_classCount, -1);
+	_outputs.assign(1, -1);
+	for(size_t rid = 0; rid < _rules.size(); ++rid){
+		int state = 0;
+		for(const char c : _rules[rid].text){
+			const size_t cls = _classes[uchar(c)];
+			int & next = _transitions[size_t(state) * _classCount + cls];
+			if(next < 0){
+				next = int(_outputs.size());
+				_outputs.push_back(-1);
+				_transitions.resize(_transitions.size() + _classCount, -1);
+			}
+			state = _transitions[size_t(state) * _classCount + cls];
+		}
+		if(better(int(rid), _outputs[state])){
+			_outputs[state] = int(rid);
+		}
+	}
+
+	// Complete transitions and outputs in breadth-first order, following failure links.
+	std::vector<int> failures(_outputs.size(), 0);
+	std::queue<int> states;
+	for(size_t cls = 0; cls < _classCount; ++cls){
+		int & next = _transitions[cls];
+		if(next < 0){
+			next = 0;
+		} else {
+			failures[next] = 0;
+			states.push(next);
+		}
+	}
+	while(!states.empty()){
+		const int state = states.front();
+		states.pop();
+		const int failure = failures[state];
+		if(better(_outputs[failure], _outputs[state])){
+			_outputs[state] = _outputs[failure];
+		}
+		for(size_t cls = 0; cls < _classCount; ++cls){
+			int & next = _transitions[size_t(state) * _classCount + cls];
+			const int fallback = _transitions[size_t(failure) * _classCount + cls];
+			if(next < 0){
+				next = fallback;
+			} else {
+				failures[next] = fallback;
+				states.push(next);
+			}
+		}
+	}
+}
+
+const std::string * Categorizer::classify(const std::string & label) const {
+	if(_rules.empty()){
+		return nullptr;
+	}
+	int state = 0;
+	int best = -1;
+	for(const char c : label){
+		state = _transitions[size_t(state) * _classCount + _classes[uchar(c)]];
+		const int output = _outputs[state];
+		if(output >= 0 && better(output, best)){
+			best = output;
+		}
+	}
+	return best < 0 ? nullptr : &_categories[_rules[best].category];
+}
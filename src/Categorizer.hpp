@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Common.hpp"
+#include "system/System.hpp"
+
+/**
+ \brief Assign categories to labels using rules associating a text to a category.
+ Rules are read from a file with one rule per line, the text and category being separated by a tab,
+ and lines starting with '#' being ignored. A label receives the category of the longest rule text it contains
+ (ignoring case), the first rule in the file winning ties.
+ All rules are compiled in a single automaton (Aho-Corasick), so that each label is only read once.
+ */
+class Categorizer {
+public:
+
+	/** Load rules from a file and build the automaton.
+	 \param path the rules file
+	 \return false if the file couldn't be read
+	 */
+	bool load(const fs::path & path);
+
+	/** Add a rule, build must be called once all rules have been added.
+	 \param text the text to look for
+	 \param category the category to assign
+	 */
+	void addRule(const std::string & text, const std::string & category);
+
+	/** Build the automaton from the rules. */
+	void build();
+
+	/** Find the category of a label.
+	 \param label the label
+	 \return the category name, or null if no rule applies
+	 */
+	const std::string * classify(const std::string & label) const;
+
+	/** \return the number of rules */
+	size_t size() const { return _rules.size(); }
+
+private:
+
+	struct Rule {
+		std::string text; ///< Lowercase text.
+		size_t category;
+	};
+
+	/** \return true if rule a should be preferred to rule b */
+	bool better(int a, int b) const;
+
+	std::vector<Rule> _rules;
+	std::vector<std::string> _categories;
+
+	// Automaton with transitions for each class of characters.
+	std::vector<uchar> _classes; ///< Class of each byte, 0 for bytes absent from all rules.
+	size_t _classCount = 1;
+	std::vector<int> _transitions; ///< Next state for each state and class.
+	std::vector<int> _outputs; ///< Best rule matching at each state, or -1.
+};
@@ -0,0 +1,379 @@
+#include "Command.hpp"
+#include "Printer.hpp"
+#include "Grapher.hpp"
+#include "DuplicateIndex.hpp"
+#include "system/TextUtilities.hpp"
+
+bool Command::parse(const KeyValues & arg){
+	if(arg.key == "delete" || arg.key == "d") {
+		action = Action::REMOVE;
+		if(!arg.values.empty()){
+			index = stol(arg.values[0]);
+		}
+		return true;
+	}
+	if(arg.key == "list" || arg.key == "l") {
+		action = Action::LIST;
+		if(!arg.values.empty()){
+			count = stol(arg.values[0]);
+		}
+		return true;
+	}
+	if(arg.key == "graph" || arg.key == "g"){
+		action = Action::GRAPH;
+		if(!arg.values.empty()){
+			months = stol(arg.values[0]);
+		}
+		if(arg.values.size() > 1){
+			height = stol(arg.values[1]);
+		}
+		return true;
+	}
+	if(arg.key == "group"){
+		action = Action::GROUP;
+		groupKeys.clear();
+		for(const std::string & value : arg.values){
+			Grouping::Key key;
+			if(!Grouping::keyFromString(value, key)){
+				Log::Error() << "Unknown grouping key \"" << value << "\" (day, week, month, year, label, tag or category expected)." << std::endl;
+				continue;
+			}
+			groupKeys.push_back(key);
+		}
+		if(groupKeys.empty()){
+			groupKeys.push_back(Grouping::Key::MONTH);
+		}
+		return true;
+	}
+	if(arg.key == "top"){
+		action = Action::TOP;
+		if(!arg.values.empty()){
+			topCount = stol(arg.values[0]);
+		}
+		if(arg.values.size() > 1){
+			topType = TextUtilities::lowercase(arg.values[1]) == "in" ? Operation::Type::In : Operation::Type::Out;
+		}
+		return true;
+	}
+	if(arg.key == "stats"){
+		action = Action::STATS;
+		for(const std::string & value : arg.values){
+			const std::string valueLow = TextUtilities::lowercase(value);
+			if(valueLow == "in" || valueLow == "out"){
+				statsType = valueLow == "in" ? Operation::Type::In : Operation::Type::Out;
+			} else if(!Grouping::keyFromString(value, statsKey)){
+				Log::Error() << "Unknown grouping key \"" << value << "\" (day, week, month, year, label, tag or category expected)." << std::endl;
+			}
+		}
+		return true;
+	}
+	if(arg.key == "search" && !arg.values.empty()){
+		action = Action::SEARCH;
+		searchText = arg.values[0];
+		if(arg.values.size() > 1){
+			count = stol(arg.values[1]);
+		}
+		return true;
+	}
+	if(arg.key == "complete"){
+		action = Action::COMPLETE;
+		searchText = arg.values.empty() ? "" : arg.values[0];
+		if(arg.values.size() > 1){
+			completeCount = stol(arg.values[1]);
+		}
+		return true;
+	}
+	if(arg.key == "totals" || arg.key == "t"){
+		action = Action::TOTAL;
+		return true;
+	}
+	if(arg.key == "add" || arg.key == "a" ) {
+		action = Action::ADD;
+		rawOp = arg.values;
+		return true;
+	}
+	if(arg.key == "skip-duplicates"){
+		skipDuplicates = true;
+		return true;
+	}
+	if(arg.key == "duplicate-window" && !arg.values.empty()){
+		duplicateWindow = stoi(arg.values[0]);
+		return true;
+	}
+	if(arg.key == "filter" && !arg.values.empty()){
+		filter.parse(TextUtilities::join(arg.values, " "));
+		return true;
+	}
+	if(arg.key == "offset" && !arg.values.empty()){
+		offset = std::max(stol(arg.values[0]), 0l);
+		return true;
+	}
+	if(arg.key == "page" && !arg.values.empty()){
+		page = std::max(stol(arg.values[0]), 1l);
+		return true;
+	}
+	if(arg.key == "format" && !arg.values.empty()){
+		if(!Exporter::formatFromString(arg.values[0], format)){
+			Log::Error() << "Unknown format \"" << arg.values[0] << "\", expected text, csv, json or ndjson." << std::endl;
+		}
+		return true;
+	}
+	// Default "add" action.
+	if(TextUtilities::isNumber(arg.key)){
+		action = Action::ADD;
+		rawOp = arg.values;
+		rawOp.insert(rawOp.begin(), arg.key);
+		return true;
+	}
+	return false;
+}
+
+bool Command::fromTokens(const std::vector<std::string> & tokens, Command & command){
+	if(tokens.empty()){
+		return false;
+	}
+	// The first token is always a key, then a double dash introduces the next one.
+	std::vector<KeyValues> args;
+	for(size_t tid = 0; tid < tokens.size(); ++tid){
+		if(tid == 0 || TextUtilities::hasPrefix(tokens[tid], "--")){
+			args.emplace_back(TextUtilities::trim(tokens[tid], "-"));
+		} else {
+			args.back().values.push_back(tokens[tid]);
+		}
+	}
+	bool known = false;
+	for(const KeyValues & arg : args){
+		if(arg.key.empty() || !command.parse(arg)){
+			return false;
+		}
+		known = true;
+	}
+	return known;
+}
+
+std::vector<std::string> Command::tokens() const {
+	std::vector<std::string> toks;
+	if(action == Action::REMOVE){
+		toks = {"delete", std::to_string(index)};
+	} else if(action == Action::ADD){
+		toks = {"add"};
+		toks.insert(toks.end(), rawOp.begin(), rawOp.end());
+		toks.insert(toks.end(), {"--duplicate-window", std::to_string(duplicateWindow)});
+		if(skipDuplicates){
+			toks.emplace_back("--skip-duplicates");
+		}
+	} else if(action == Action::LIST){
+		toks = {"list", std::to_string(count), "--offset", std::to_string(offset), "--page", std::to_string(page)};
+	} else if(action == Action::GRAPH){
+		toks = {"graph", std::to_string(months), std::to_string(height)};
+	} else if(action == Action::TOP){
+		toks = {"top", std::to_string(topCount), topType == Operation::Type::In ? "in" : "out"};
+	} else if(action == Action::SEARCH){
+		toks = {"search", searchText, std::to_string(count)};
+	} else if(action == Action::COMPLETE){
+		toks = {"complete", searchText, std::to_string(completeCount)};
+	} else if(action == Action::STATS){
+		toks = {"stats", TextUtilities::lowercase(Grouping::keyName(statsKey)), statsType == Operation::Type::In ? "in" : "out"};
+	} else if(action == Action::GROUP){
+		toks = {"group"};
+		for(const Grouping::Key key : groupKeys){
+			toks.push_back(TextUtilities::lowercase(Grouping::keyName(key)));
+		}
+	} else {
+		toks = {"totals"};
+	}
+	if(!filter.expression().empty()){
+		toks.insert(toks.end(), {"--filter", filter.expression()});
+	}
+	if(format != Exporter::Format::TEXT){
+		toks.insert(toks.end(), {"--format", Exporter::formatName(format)});
+	}
+	return toks;
+}
+
+bool Command::modifies() const {
+	return action == Action::ADD || action == Action::REMOVE;
+}
+
+bool Command::run(Listing & list, bool summary) const {
+	if(!filter.valid()){
+		return false;
+	}
+	if(format != Exporter::Format::TEXT && exportResult(list)){
+		return true;
+	}
+	if(action == Action::LIST){
+		if(filter.empty()){
+			const std::pair<long, long> range = listRange(list);
+			Printer::printList(list, range.first, range.second);
+		} else {
+			const std::vector<long> indices = listSelection(list);
+			std::vector<Operation> ops;
+			ops.reserve(indices.size());
+			for(const long oid : indices){
+				ops.push_back(list.operation(oid));
+			}
+			Printer::printList(ops, indices, list.count());
+		}
+		Printer::printTotals(list.totals(filter), false);
+	}
+	if(action == Action::GRAPH){
+		const auto monthTotals = list.monthTotals(months, filter);
+		Grapher::graphMonths(monthTotals, list.totals(filter), height);
+	}
+	if(action == Action::TOP){
+		const std::vector<long> indices = list.top(topCount, topType, filter);
+		std::vector<Operation> ops;
+		ops.reserve(indices.size());
+		for(const long oid : indices){
+			ops.push_back(list.operation(oid));
+		}
+		Printer::printList(ops, indices, list.count());
+	}
+	if(action == Action::SEARCH){
+		std::vector<long> indices = list.labelIndex().search(searchText);
+		if(count > 0 && long(indices.size()) > count){
+			indices.erase(indices.begin(), indices.end() - count);
+		}
+		std::vector<Operation> ops;
+		ops.reserve(indices.size());
+		for(const long oid : indices){
+			ops.push_back(list.operation(oid));
+		}
+		Printer::printList(ops, indices, list.count());
+	}
+	if(action == Action::COMPLETE){
+		Printer::printLabels(list.labelIndex().complete(searchText, size_t(std::max(completeCount, 0l))));
+	}
+	if(action == Action::STATS){
+		const auto groups = Statistics::compute(list, statsKey, statsType, filter);
+		Printer::printStatistics(groups, statsKey, 3);
+	}
+	if(action == Action::GROUP){
+		const auto groups = Grouping::compute(list, groupKeys, filter);
+		Printer::printGroups(groups, groupKeys);
+		Printer::printTotals(list.totals(filter), false);
+	}
+	if(action == Action::REMOVE){
+		list.removeOperation(index);
+		if(summary){
+			printSummary(list);
+		}
+	}
+	if(action == Action::ADD){
+		if(rawOp.empty()){
+			list.addOperation(rawOp);
+		} else {
+			const Operation operation = Operation::fromArguments(rawOp);
+			const bool duplicate = list.containsDuplicate(operation, duplicateWindow);
+			if(duplicate){
+				DuplicateIndex::report(operation, skipDuplicates);
+			}
+			if(!duplicate || !skipDuplicates){
+				list.addOperation(operation);
+			}
+		}
+		if(summary){
+			printSummary(list);
+		}
+	}
+	if(action == Action::TOTAL){
+		Printer::printTotals(list.totals(filter));
+	}
+	return true;
+}
+
+long Command::skipped() const {
+	return offset + (count > 0 ? (page - 1) * count : 0);
+}
+
+std::pair<long, long> Command::listRange(const Listing & list) const {
+	const long end = std::max(list.count() - skipped(), 0l);
+	const long first = count > 0 ? std::max(end - count, 0l) : 0;
+	return {first, end};
+}
+
+std::vector<long> Command::listSelection(const Listing & list) const {
+	const long skip = skipped();
+	std::vector<long> indices = list.select(filter, count > 0 ? count + skip : 0);
+	indices.erase(indices.end() - std::min(skip, long(indices.size())), indices.end());
+	if(count > 0 && long(indices.size()) > count){
+		indices.erase(indices.begin(), indices.end() - count);
+	}
+	return indices;
+}
+
+bool Command::exportResult(const Listing & list) const {
+	Exporter exporter(format);
+	if(action == Action::LIST){
+		if(filter.empty()){
+			// Serialize straight from the listing.
+			const std::pair<long, long> range = listRange(list);
+			exporter.writeOperations(list, range.first, range.second);
+		} else {
+			exporter.writeOperations(list, listSelection(list));
+		}
+	} else if(action == Action::TOP){
+		exporter.writeOperations(list, list.top(topCount, topType, filter));
+	} else if(action == Action::SEARCH){
+		std::vector<long> indices = list.labelIndex().search(searchText);
+		if(count > 0 && long(indices.size()) > count){
+			indices.erase(indices.begin(), indices.end() - count);
+		}
+		exporter.writeOperations(list, indices);
+	} else if(action == Action::GRAPH){
+		Date firstMonth;
+		const std::vector<Totals> monthTotals = list.monthTotals(months, filter, firstMonth);
+		exporter.writeMonths(monthTotals, firstMonth);
+	} else if(action == Action::GROUP){
+		exporter.writeGroups(Grouping::compute(list, groupKeys, filter), groupKeys);
+	} else if(action == Action::STATS){
+		exporter.writeStatistics(Statistics::compute(list, statsKey, statsType, filter), statsKey);
+	} else if(action == Action::COMPLETE){
+		exporter.writeLabels(list.labelIndex().complete(searchText, size_t(std::max(completeCount, 0l))));
+	} else if(action == Action::TOTAL){
+		exporter.writeTotals(list.totals(filter));
+	} else {
+		return false;
+	}
+	return true;
+}
+
+void Command::printSummary(const Listing & list) const {
+	if(format != Exporter::Format::TEXT){
+		Exporter(format).writeTotals(list.totals());
+	} else {
+		Printer::printTotals(list.totals());
+	}
+}
+
+bool Command::runFromIndex(const fs::path & path) const {
+	std::unique_ptr<LabelIndex> index;
+	if((action != Action::SEARCH && action != Action::COMPLETE) || !LabelIndex::load(path, index)){
+		return false;
+	}
+	if(action == Action::COMPLETE){
+		const std::vector<std::string> labels = index->complete(searchText, size_t(std::max(completeCount, 0l)));
+		if(format != Exporter::Format::TEXT){
+			Exporter(format).writeLabels(labels);
+		} else {
+			Printer::printLabels(labels);
+		}
+		return true;
+	}
+	std::vector<long> indices = index->search(searchText);
+	if(count > 0 && long(indices.size()) > count){
+		indices.erase(indices.begin(), indices.end() - count);
+	}
+	std::vector<Operation> ops;
+	ops.reserve(indices.size());
+	for(const long oid : indices){
+		ops.push_back(index->operation(oid));
+	}
+	if(format != Exporter::Format::TEXT){
+		Exporter(format).writeOperations(ops, indices);
+	} else {
+		Printer::printList(ops, indices, index->count());
+	}
+	return true;
+}
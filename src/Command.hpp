@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Common.hpp"
+#include "Listing.hpp"
+#include "Grouping.hpp"
+#include "Exporter.hpp"
+#include "system/Config.hpp"
+
+enum class Action {
+	ADD, REMOVE, LIST, TOTAL, GRAPH, GROUP, TOP, STATS, SEARCH, COMPLETE
+};
+
+/**
+ \brief A single action on a listing, with its parameters, that can be sent to a server.
+ */
+class Command {
+public:
+
+	/** Interpret an argument as a command, updating the action and its parameters.
+	 \param arg the argument key and values
+	 \return true if the argument was a command
+	 */
+	bool parse(const KeyValues & arg);
+
+	/** Build a command from tokens, the first one being the command name. Tokens beginning with a double dash introduce options.
+	 \param tokens the command name and its values, followed by options
+	 \param command will contain the parsed command
+	 \return true if the tokens described a known command
+	 */
+	static bool fromTokens(const std::vector<std::string> & tokens, Command & command);
+
+	/** Serialize the command as a list of tokens.
+	 \return the command name and its values
+	 */
+	std::vector<std::string> tokens() const;
+
+	/** \return true if running the command modifies the listing */
+	bool modifies() const;
+
+	/** Run the command on a listing and print the result.
+	 \param list the listing to query or update
+	 \param summary should the totals be printed after a modification
+	 \return false if the command couldn't run, because of an invalid filter
+	 */
+	bool run(Listing & list, bool summary = true) const;
+
+	/** Run a search or completion command using a label index saved next to a listing, without loading the listing.
+	 \param path the listing file
+	 \return false if there is no up to date index
+	 */
+	bool runFromIndex(const fs::path & path) const;
+
+	Action action = Action::TOTAL;
+	std::vector<std::string> rawOp;
+	long index = -1;
+	long count = 40;
+	long months = 12;
+	long height = 24;
+	int duplicateWindow = 0;
+	bool skipDuplicates = false;
+	std::string searchText; ///< Searched text or completed prefix.
+	long completeCount = 10;
+	std::vector<Grouping::Key> groupKeys;
+	long topCount = 10;
+	Operation::Type topType = Operation::Type::Out;
+	Grouping::Key statsKey = Grouping::Key::MONTH;
+	Operation::Type statsType = Operation::Type::Out;
+	Filter filter; ///< Operations considered by list, totals, graph and group.
+	Exporter::Format format = Exporter::Format::TEXT; ///< Output format of all results.
+	long offset = 0; ///< Number of most recent operations skipped by list.
+	long page = 1; ///< Page of list results, the first one containing the most recent operations.
+
+private:
+
+	/** \return the number of most recent operations skipped by list, from the offset and page */
+	long skipped() const;
+
+	/** Find the range of operations listed when there is no filter.
+	 \param list the listing
+	 \return the first listed operation index, and the index after the last one
+	 */
+	std::pair<long, long> listRange(const Listing & list) const;
+
+	/** Find the operations listed when there is a filter.
+	 \param list the listing
+	 \return the indices of the listed operations
+	 */
+	std::vector<long> listSelection(const Listing & list) const;
+
+	/** Write the result of the command in a machine-readable format.
+	 \param list the listing to query
+	 \return false if the action modifies the listing, its summary is written afterwards
+	 */
+	bool exportResult(const Listing & list) const;
+
+	/** Print the totals of the listing after a modification, in the output format.
+	 \param list the modified listing
+	 */
+	void printSummary(const Listing & list) const;
+};
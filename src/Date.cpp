@@ -2,19 +2,41 @@
 #include "system/TextUtilities.hpp"
 
 #include <iomanip>
+#include <locale>
+
+namespace {
+
+	/// Write a positive integer on a fixed number of digits, zero-padded.
+	char * writeDigits(char * dst, int value, int count){
+		for(int i = count - 1; i >= 0; --i){
+			dst[i] = char('0' + (value % 10));
+			value /= 10;
+		}
+		return dst + count;
+	}
+
+	/// Thread-safe access to the current local time.
+	std::tm currentTime(){
+		const std::time_t t = std::time(nullptr);
+		std::tm now;
+#ifdef _WIN32
+		localtime_s(&now, &t);
+#else
+		localtime_r(&t, &now);
+#endif
+		return now;
+	}
+
+}
 
 Date::Date(){
 	// Initialize the date at the current time.
-	std::time_t t = std::time(0);
-	std::tm* now = std::localtime(&t);
-	_date = std::tm(*now);
+	_date = currentTime();
 }
 
 Date::Date(const std::string & date) {
 	// Initialize the date at the current time.
-	std::time_t t = std::time(0);
-	std::tm* now = std::localtime(&t);
-	_date = std::tm(*now);
+	_date = currentTime();
 
 	// Process the string.
 	auto tokens = TextUtilities::split(date, "/", true);
@@ -28,6 +50,14 @@ Date::Date(const std::string & date) {
 	}
 }
 
+Date::Date(int year, int month, int day) {
+	// Only the day is used, no need to query the clock.
+	_date = std::tm();
+	_date.tm_year = year - 1900;
+	_date.tm_mon = month - 1;
+	_date.tm_mday = day;
+}
+
 Date Date::dateFromTokens(const std::string & toks) {
 	Date date;
 	// Process the string.
@@ -46,14 +76,67 @@ Date Date::dateFromTokens(const std::string & toks) {
 }
 
 std::string Date::toString(const std::string & format, const std::string & locale) const {
+	// Use the precompiled formatters when possible.
+	if(locale.empty()){
+		if(format == "%Y/%m/%d"){
+			return toString(Format::YearMonthDay);
+		}
+		if(format == "%d/%m/%y"){
+			return toString(Format::DayMonthYearShort);
+		}
+	}
+
+	// Only build a locale when it changes.
+	thread_local std::string cachedName;
+	thread_local std::locale cachedLocale;
+
 	std::stringstream str;
 	if(!locale.empty()){
-		str.imbue(std::locale(locale));
+		if(locale != cachedName){
+			cachedLocale = std::locale(locale);
+			cachedName = locale;
+		}
+		str.imbue(cachedLocale);
 	}
 	str << std::put_time(&_date, format.c_str());
 	return str.str();
 }
 
+std::string Date::toString(Format format) const {
+	char buffer[16];
+	const size_t size = write(format, buffer);
+	return std::string(buffer, size);
+}
+
+size_t Date::write(Format format, char * dst) const {
+	const int y = year();
+	const int m = month();
+	const int d = day();
+	// Values that don't fit in the fixed widths are rare enough to use the generic path.
+	if(y < 0 || y > 9999 || m < 0 || m > 99 || d < 0 || d > 99){
+		const std::string str = toString(format == Format::YearMonthDay ? "%Y/%m/%d" : "%d/%m/%y", "C");
+		const size_t size = std::min(str.size(), size_t(15));
+		str.copy(dst, size);
+		return size;
+	}
+
+	char * end = dst;
+	if(format == Format::YearMonthDay){
+		end = writeDigits(end, y, 4);
+		*(end++) = '/';
+		end = writeDigits(end, m, 2);
+		*(end++) = '/';
+		end = writeDigits(end, d, 2);
+	} else {
+		end = writeDigits(end, d, 2);
+		*(end++) = '/';
+		end = writeDigits(end, m, 2);
+		*(end++) = '/';
+		end = writeDigits(end, y % 100, 2);
+	}
+	return size_t(end - dst);
+}
+
 int Date::day() const {
 	return _date.tm_mday;
 }
@@ -65,3 +148,36 @@ int Date::month() const {
 int Date::year() const {
 	return _date.tm_year + 1900;
 }
+
+int Date::key() const {
+	return year() * 10000 + month() * 100 + day();
+}
+
+long Date::dayNumber() const {
+	// Days from civil algorithm, with years starting in March.
+	const long m = month();
+	const long y = long(year()) - (m <= 2 ? 1 : 0);
+	const long era = (y >= 0 ? y : y - 399) / 400;
+	const long yoe = y - era * 400;
+	const long doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + long(day()) - 1;
+	const long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 719468;
+}
+
+Date Date::fromDayNumber(long days) {
+	// Civil from days algorithm, inverse of dayNumber.
+	const long z = days + 719468;
+	const long era = (z >= 0 ? z : z - 146096) / 146097;
+	const long doe = z - era * 146097;
+	const long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	const long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	const long mp = (5 * doy + 2) / 153;
+	const long d = doy - (153 * mp + 2) / 5 + 1;
+	const long m = mp < 10 ? mp + 3 : mp - 9;
+	const long y = yoe + era * 400 + (m <= 2 ? 1 : 0);
+	return Date(int(y), int(m), int(d));
+}
+
+bool Date::operator<(const Date & other) const {
+	return key() < other.key();
+}
@@ -5,22 +5,52 @@
 class Date {
 public:
 
+	/// Fixed formats with a dedicated formatter.
+	enum class Format {
+		YearMonthDay, ///< "%Y/%m/%d", used for storage.
+		DayMonthYearShort ///< "%d/%m/%y", used for display.
+	};
+
 	Date();
 
 	Date(const std::string & date);
 
+	Date(int year, int month, int day);
+
 	std::string toString(const std::string & format, const std::string & local = "") const;
 
+	std::string toString(Format format) const;
+
+	/** Write the date in a fixed format to a buffer, without any allocation.
+	 \param format the format to use
+	 \param dst the destination buffer, at least 16 characters long
+	 \return the number of characters written
+	 */
+	size_t write(Format format, char * dst) const;
+
 	int day() const;
 
 	int month() const;
 
 	int year() const;
 
+	/** \return a key preserving the chronological order of days (YYYYMMDD) */
+	int key() const;
+
+	/** \return the number of days elapsed since 1970/01/01 */
+	long dayNumber() const;
+
+	bool operator<(const Date & other) const;
+
 	static Date dateFromTokens(const std::string & tokens);
 
+	/** Build the date a number of days after 1970/01/01.
+	 \param days the number of days
+	 \return the date
+	 */
+	static Date fromDayNumber(long days);
+
 private:
 
 	std::tm _date;
 };
-
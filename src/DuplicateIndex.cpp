@@ -0,0 +1,71 @@
+#include "DuplicateIndex.hpp"
+#include "Listing.hpp"
+#include "system/TextUtilities.hpp"
+
+bool DuplicateIndex::Key::operator==(const Key & other) const {
+	return amount == other.amount && label == other.label;
+}
+
+size_t DuplicateIndex::KeyHash::operator()(const Key & key) const {
+	const size_t h = std::hash<std::string>()(key.label);
+	return h ^ (std::hash<Amount>()(key.amount) + 0x9e3779b9 + (h << 6) + (h >> 2));
+}
+
+DuplicateIndex::DuplicateIndex(const Listing & list, int window) : _window(std::max(window, 0)) {
+	const long count = list.count();
+	_days.reserve(size_t(count));
+	for(long oid = 0; oid < count; ++oid){
+		insert(list.operation(oid));
+	}
+}
+
+bool DuplicateIndex::consume(const Operation & operation){
+	const auto entry = _days.find({operation.amount(), TextUtilities::normalize(operation.label())});
+	if(entry == _days.end()){
+		return false;
+	}
+	std::vector<long> & days = entry->second;
+	const size_t best = closest(days, operation.date().dayNumber());
+	if(best == days.size()){
+		return false;
+	}
+	// Remove it so that it isn't matched again.
+	days.erase(days.begin() + best);
+	return true;
+}
+
+bool DuplicateIndex::contains(const Operation & operation) const {
+	const auto entry = _days.find({operation.amount(), TextUtilities::normalize(operation.label())});
+	if(entry == _days.end()){
+		return false;
+	}
+	return closest(entry->second, operation.date().dayNumber()) != entry->second.size();
+}
+
+size_t DuplicateIndex::closest(const std::vector<long> & days, long day) const {
+	// Only the days around the operation day can be the closest, prefer the earlier one.
+	const size_t after = size_t(std::lower_bound(days.begin(), days.end(), day) - days.begin());
+	size_t best = days.size();
+	long bestDistance = _window + 1;
+	if(after > 0 && day - days[after - 1] < bestDistance){
+		bestDistance = day - days[after - 1];
+		best = after - 1;
+	}
+	if(after < days.size() && days[after] - day < bestDistance){
+		best = after;
+	}
+	return best;
+}
+
+void DuplicateIndex::insert(const Operation & operation){
+	std::vector<long> & days = _days[{operation.amount(), TextUtilities::normalize(operation.label())}];
+	const long day = operation.date().dayNumber();
+	// Operations are mostly inserted in chronological order.
+	days.insert(std::upper_bound(days.begin(), days.end(), day), day);
+}
+
+void DuplicateIndex::report(const Operation & operation, bool skipped){
+	Log::Warning() << (skipped ? "Skipped duplicate: " : "Possible duplicate: ")
+		<< operation.date().toString(Date::Format::YearMonthDay) << " "
+		<< Operation::writeAmount(operation.amount(), true) << " " << operation.label() << std::endl;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Common.hpp"
+#include "Operation.hpp"
+
+#include <unordered_map>
+
+class Listing;
+
+/**
+ \brief Find operations already present in a listing, with the same amount and label and a close date.
+ Labels are compared once normalized (case, punctuation and spacing are ignored).
+ */
+class DuplicateIndex {
+public:
+
+	/** Index all operations of a listing.
+	 \param list the listing
+	 \param window maximum number of days between two duplicates
+	 */
+	DuplicateIndex(const Listing & list, int window);
+
+	/** Check if an operation is a duplicate of an indexed one. Each indexed operation can only be matched once,
+	 so that repeated identical operations are only reported if there are more of them than in the listing.
+	 \param operation the operation to look for
+	 \return true if a duplicate was found
+	 */
+	bool consume(const Operation & operation);
+
+	/** Check if an operation is a duplicate of an indexed one, without consuming it.
+	 \param operation the operation to look for
+	 \return true if a duplicate was found
+	 */
+	bool contains(const Operation & operation) const;
+
+	/** Index an additional operation.
+	 \param operation the operation to index
+	 */
+	void insert(const Operation & operation);
+
+	/** Print a duplicate operation in a warning.
+	 \param operation the duplicate operation
+	 \param skipped was the operation skipped
+	 */
+	static void report(const Operation & operation, bool skipped);
+
+	/** \return the maximum number of days between two duplicates */
+	int window() const { return int(_window); }
+
+private:
+
+	struct Key {
+		Amount amount;
+		std::string label;
+
+		bool operator==(const Key & other) const;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key & key) const;
+	};
+
+	/** Find the day closest to an operation, in the window, in O(log n).
+	 \param days the sorted indexed days sharing the operation amount and label
+	 \param day the operation day
+	 \return the position of the closest day, or days.size() if none is close enough
+	 */
+	size_t closest(const std::vector<long> & days, long day) const;
+
+	std::unordered_map<Key, std::vector<long>, KeyHash> _days; ///< Sorted days of the operations sharing the same amount and label.
+	const long _window; ///< Tolerance on dates, in days.
+};
@@ -0,0 +1,382 @@
+#include "Exporter.hpp"
+#include "system/TextUtilities.hpp"
+#include "system/Terminal.hpp"
+#include "system/Profiler.hpp"
+
+namespace {
+	const size_t bufferCapacity = 1 << 16;
+}
+
+bool Exporter::formatFromString(const std::string & name, Format & format){
+	const std::string nameLow = TextUtilities::lowercase(name);
+	if(nameLow == "text"){
+		format = Format::TEXT;
+	} else if(nameLow == "csv"){
+		format = Format::CSV;
+	} else if(nameLow == "json"){
+		format = Format::JSON;
+	} else if(nameLow == "ndjson"){
+		format = Format::NDJSON;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+std::string Exporter::formatName(Format format){
+	switch(format){
+		case Format::CSV: return "csv";
+		case Format::JSON: return "json";
+		case Format::NDJSON: return "ndjson";
+		default: return "text";
+	}
+}
+
+Exporter::Exporter(Format format) : _format(format) {
+	_buffer.reserve(bufferCapacity);
+}
+
+Exporter::~Exporter(){
+	flush();
+}
+
+void Exporter::writeOperations(const Listing & list, long first, long end){
+	Profiler::Scope scope("Export");
+	beginRecords({"index", "date", "amount", "label", "category"});
+	first = std::max(first, 0l);
+	end = std::min(end, list.count());
+	for(long oid = first; oid < end; ++oid){
+		writeOperation(oid, list.operation(oid));
+	}
+	endRecords();
+	scope.count(size_t(std::max(end - first, 0l)));
+}
+
+void Exporter::writeOperations(const Listing & list, const std::vector<long> & indices){
+	Profiler::Scope scope("Export");
+	beginRecords({"index", "date", "amount", "label", "category"});
+	for(const long oid : indices){
+		writeOperation(oid, list.operation(oid));
+	}
+	endRecords();
+	scope.count(indices.size());
+}
+
+void Exporter::writeOperations(const std::vector<Operation> & operations, const std::vector<long> & indices){
+	Profiler::Scope scope("Export");
+	beginRecords({"index", "date", "amount", "label", "category"});
+	for(size_t oid = 0; oid < operations.size(); ++oid){
+		writeOperation(indices[oid], operations[oid]);
+	}
+	endRecords();
+	scope.count(operations.size());
+}
+
+void Exporter::writeTotals(const Totals & totals){
+	beginRecords({"incomes", "expenses", "total"}, true);
+	beginRecord();
+	field("incomes");
+	writeAmount(totals.first);
+	field("expenses");
+	writeAmount(totals.second);
+	field("total");
+	writeAmount(totals.first + totals.second);
+	endRecord();
+	endRecords();
+}
+
+void Exporter::writeMonths(const std::vector<Totals> & months, const Date & firstMonth){
+	const long first = long(firstMonth.year()) * 12 + long(firstMonth.month() - 1);
+
+	beginRecords({"month", "incomes", "expenses", "total"});
+	for(size_t mid = 0; mid < months.size(); ++mid){
+		const long month = first + long(mid);
+		char str[8];
+		const int year = int(month / 12);
+		const int monthOfYear = int(month % 12) + 1;
+		str[0] = char('0' + (year / 1000) % 10);
+		str[1] = char('0' + (year / 100) % 10);
+		str[2] = char('0' + (year / 10) % 10);
+		str[3] = char('0' + year % 10);
+		str[4] = '-';
+		str[5] = char('0' + monthOfYear / 10);
+		str[6] = char('0' + monthOfYear % 10);
+
+		beginRecord();
+		field("month");
+		if(_format != Format::CSV){
+			write('"');
+		}
+		write(str, 7);
+		if(_format != Format::CSV){
+			write('"');
+		}
+		field("incomes");
+		writeAmount(months[mid].first);
+		field("expenses");
+		writeAmount(months[mid].second);
+		field("total");
+		writeAmount(months[mid].first + months[mid].second);
+		endRecord();
+	}
+	endRecords();
+}
+
+void Exporter::writeGroups(const std::vector<Grouping::Group> & groups, const std::vector<Grouping::Key> & keys){
+	std::vector<std::string> columns;
+	for(const Grouping::Key key : keys){
+		columns.push_back(TextUtilities::lowercase(Grouping::keyName(key)));
+	}
+	const size_t keyCount = columns.size();
+	for(const char * column : {"count", "incomes", "expenses", "total", "min", "max", "mean"}){
+		columns.emplace_back(column);
+	}
+
+	beginRecords(columns);
+	for(const Grouping::Group & group : groups){
+		beginRecord();
+		for(size_t kid = 0; kid < keyCount; ++kid){
+			field(columns[kid]);
+			writeString(group.keys[kid]);
+		}
+		field("count");
+		writeInteger(group.count);
+		field("incomes");
+		writeAmount(group.totals.first);
+		field("expenses");
+		writeAmount(group.totals.second);
+		field("total");
+		writeAmount(group.totals.first + group.totals.second);
+		field("min");
+		writeAmount(group.min);
+		field("max");
+		writeAmount(group.max);
+		field("mean");
+		writeAmount(group.mean());
+		endRecord();
+	}
+	endRecords();
+}
+
+void Exporter::writeStatistics(const std::vector<std::pair<std::string, Statistics>> & groups, Grouping::Key key){
+	const std::string keyColumn = TextUtilities::lowercase(Grouping::keyName(key));
+	beginRecords({keyColumn, "count", "total", "mean", "deviation", "median", "p90"});
+	for(const auto & group : groups){
+		const Statistics & stats = group.second;
+		beginRecord();
+		field(keyColumn);
+		writeString(group.first);
+		field("count");
+		writeInteger(stats.count());
+		field("total");
+		writeAmount(stats.total());
+		field("mean");
+		writeAmount(stats.mean());
+		field("deviation");
+		writeAmount(stats.deviation());
+		field("median");
+		writeAmount(stats.quantile(0.5));
+		field("p90");
+		writeAmount(stats.quantile(0.9));
+		endRecord();
+	}
+	endRecords();
+}
+
+void Exporter::writeLabels(const std::vector<std::string> & labels){
+	beginRecords({"label"});
+	for(const std::string & label : labels){
+		beginRecord();
+		field("label");
+		writeString(label);
+		endRecord();
+	}
+	endRecords();
+}
+
+void Exporter::beginRecords(const std::vector<std::string> & columns, bool single){
+	_firstRecord = true;
+	_single = single;
+	if(_format == Format::CSV){
+		for(size_t cid = 0; cid < columns.size(); ++cid){
+			if(cid != 0){
+				write(',');
+			}
+			write(columns[cid].data(), columns[cid].size());
+		}
+		write('\n');
+	} else if(_format == Format::JSON && !_single){
+		write('[');
+	}
+}
+
+void Exporter::endRecords(){
+	if(_format == Format::JSON){
+		if(!_single){
+			write(_firstRecord ? "]" : "\n]", _firstRecord ? 1 : 2);
+		}
+		write('\n');
+	}
+}
+
+void Exporter::beginRecord(){
+	_firstField = true;
+	if(_format == Format::JSON && !_single){
+		write(_firstRecord ? "\n" : ",\n", _firstRecord ? 1 : 2);
+	}
+	if(_format != Format::CSV){
+		write('{');
+	}
+	_firstRecord = false;
+}
+
+void Exporter::endRecord(){
+	if(_format == Format::CSV){
+		write('\n');
+	} else if(_format == Format::NDJSON){
+		write("}\n", 2);
+	} else {
+		write('}');
+	}
+}
+
+void Exporter::field(const std::string & name){
+	if(!_firstField){
+		write(',');
+	}
+	_firstField = false;
+	if(_format != Format::CSV){
+		write('"');
+		write(name.data(), name.size());
+		write("\":", 2);
+	}
+}
+
+void Exporter::writeOperation(long index, const Operation & operation){
+	beginRecord();
+	field("index");
+	writeInteger(index);
+	field("date");
+	writeDate(operation.date());
+	field("amount");
+	writeAmount(operation.amount());
+	field("label");
+	writeString(operation.label());
+	field("category");
+	writeString(operation.category());
+	endRecord();
+}
+
+void Exporter::writeAmount(Amount amount){
+	// Fixed point, with two decimals.
+	char str[32];
+	size_t pos = sizeof(str);
+	unsigned long long value = amount < 0 ? 0ull - (unsigned long long)(amount) : (unsigned long long)(amount);
+	str[--pos] = char('0' + value % 10);
+	value /= 10;
+	str[--pos] = char('0' + value % 10);
+	value /= 10;
+	str[--pos] = '.';
+	do {
+		str[--pos] = char('0' + value % 10);
+		value /= 10;
+	} while(value != 0);
+	if(amount < 0){
+		str[--pos] = '-';
+	}
+	write(str + pos, sizeof(str) - pos);
+}
+
+void Exporter::writeInteger(long long value){
+	char str[24];
+	size_t pos = sizeof(str);
+	unsigned long long abs = value < 0 ? 0ull - (unsigned long long)(value) : (unsigned long long)(value);
+	do {
+		str[--pos] = char('0' + abs % 10);
+		abs /= 10;
+	} while(abs != 0);
+	if(value < 0){
+		str[--pos] = '-';
+	}
+	write(str + pos, sizeof(str) - pos);
+}
+
+void Exporter::writeDate(const Date & date){
+	char str[18];
+	const bool quoted = _format != Format::CSV;
+	str[0] = '"';
+	size_t size = date.write(Date::Format::YearMonthDay, str + 1);
+	// ISO 8601 separators.
+	for(size_t cid = 1; cid <= size; ++cid){
+		if(str[cid] == '/'){
+			str[cid] = '-';
+		}
+	}
+	str[size + 1] = '"';
+	write(quoted ? str : str + 1, quoted ? size + 2 : size);
+}
+
+void Exporter::writeString(const std::string & str){
+	if(_format == Format::CSV){
+		// Quote fields containing separators, quotes or line breaks (RFC 4180).
+		if(str.find_first_of(",\"\r\n") == std::string::npos){
+			write(str.data(), str.size());
+			return;
+		}
+		write('"');
+		size_t begin = 0;
+		for(size_t cid = 0; cid < str.size(); ++cid){
+			if(str[cid] == '"'){
+				write(str.data() + begin, cid + 1 - begin);
+				write('"');
+				begin = cid + 1;
+			}
+		}
+		write(str.data() + begin, str.size() - begin);
+		write('"');
+		return;
+	}
+
+	write('"');
+	size_t begin = 0;
+	for(size_t cid = 0; cid < str.size(); ++cid){
+		const unsigned char c = (unsigned char)(str[cid]);
+		if(c != '"' && c != '\\' && c >= 0x20){
+			continue;
+		}
+		write(str.data() + begin, cid - begin);
+		begin = cid + 1;
+		if(c == '"' || c == '\\'){
+			write('\\');
+			write(char(c));
+		} else {
+			const char * hex = "0123456789abcdef";
+			const char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+			write(escaped, 6);
+		}
+	}
+	write(str.data() + begin, str.size() - begin);
+	write('"');
+}
+
+void Exporter::write(const char * str, size_t size){
+	if(_buffer.size() + size > bufferCapacity){
+		flush();
+	}
+	_buffer.append(str, size);
+}
+
+void Exporter::write(char c){
+	if(_buffer.size() == bufferCapacity){
+		flush();
+	}
+	_buffer.push_back(c);
+}
+
+void Exporter::flush(){
+	if(_buffer.empty()){
+		return;
+	}
+	Terminal::outputUnicode(_buffer);
+	_buffer.clear();
+}
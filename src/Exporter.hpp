@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Common.hpp"
+#include "Listing.hpp"
+#include "Grouping.hpp"
+#include "Statistics.hpp"
+
+/**
+ \brief Write results in machine-readable formats (CSV, JSON or NDJSON), for other programs.
+ Values are serialized directly into a fixed-size buffer, sent to the terminal when full.
+ Dates are written as YYYY-MM-DD, amounts as signed decimal numbers.
+ */
+class Exporter {
+public:
+
+	/// Output formats.
+	enum class Format {
+		TEXT, ///< Decorated tables, printed by Printer.
+		CSV, ///< Comma-separated values with a header line.
+		JSON, ///< An array of objects, or a single object.
+		NDJSON ///< One object per line.
+	};
+
+	/** Find a format from its name.
+	 \param name the format name (text, csv, json or ndjson)
+	 \param format will contain the format
+	 \return true if the name is known
+	 */
+	static bool formatFromString(const std::string & name, Format & format);
+
+	/** \return the name of a format */
+	static std::string formatName(Format format);
+
+	/** Constructor.
+	 \param format the output format, not TEXT
+	 */
+	explicit Exporter(Format format);
+
+	/** Destructor, outputs the remaining content. */
+	~Exporter();
+
+	/** Write a range of operations.
+	 \param list the listing
+	 \param first the index of the first operation
+	 \param end the index after the last operation
+	 */
+	void writeOperations(const Listing & list, long first, long end);
+
+	/** Write operations of a listing.
+	 \param list the listing
+	 \param indices the indices of the operations to write
+	 */
+	void writeOperations(const Listing & list, const std::vector<long> & indices);
+
+	/** Write operations and their indices.
+	 \param operations the operations
+	 \param indices the index of each operation
+	 */
+	void writeOperations(const std::vector<Operation> & operations, const std::vector<long> & indices);
+
+	/** Write incomes, expenses and their sum.
+	 \param totals the totals
+	 */
+	void writeTotals(const Totals & totals);
+
+	/** Write the totals of consecutive months.
+	 \param months the totals of each month, oldest first
+	 \param firstMonth a day of the first month
+	 */
+	void writeMonths(const std::vector<Totals> & months, const Date & firstMonth);
+
+	/** Write aggregated groups.
+	 \param groups the groups
+	 \param keys the grouping keys
+	 */
+	void writeGroups(const std::vector<Grouping::Group> & groups, const std::vector<Grouping::Key> & keys);
+
+	/** Write the distribution statistics of groups.
+	 \param groups the statistics of each group
+	 \param key the grouping key
+	 */
+	void writeStatistics(const std::vector<std::pair<std::string, Statistics>> & groups, Grouping::Key key);
+
+	/** Write a list of labels.
+	 \param labels the labels
+	 */
+	void writeLabels(const std::vector<std::string> & labels);
+
+	Exporter(const Exporter &) = delete;
+	Exporter & operator=(const Exporter &) = delete;
+
+private:
+
+	/** Begin a list of records: CSV header, or JSON array.
+	 \param columns the name of each field
+	 \param single will there be a single record, written as a JSON object
+	 */
+	void beginRecords(const std::vector<std::string> & columns, bool single = false);
+
+	void endRecords();
+
+	void beginRecord();
+
+	void endRecord();
+
+	/** Begin a field, writing the separator and the field name when needed.
+	 \param name the field name
+	 */
+	void field(const std::string & name);
+
+	void writeOperation(long index, const Operation & operation);
+
+	void writeAmount(Amount amount);
+
+	void writeInteger(long long value);
+
+	void writeDate(const Date & date);
+
+	/** Write a string, quoted and escaped as needed.
+	 \param str the string to write
+	 */
+	void writeString(const std::string & str);
+
+	void write(const char * str, size_t size);
+
+	void write(char c);
+
+	void flush();
+
+	const Format _format;
+	std::string _buffer; ///< Pending output, fixed capacity.
+	bool _firstRecord = true;
+	bool _firstField = true;
+	bool _single = false;
+};
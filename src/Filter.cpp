@@ -0,0 +1,239 @@
+#include "Filter.hpp"
+#include "system/TextUtilities.hpp"
+
+namespace {
+
+	char lower(char c){
+		return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+	}
+
+	/// Case-insensitive comparison with an already lowercase string.
+	bool equalsLower(const std::string & str, const std::string & lowerStr){
+		if(str.size() != lowerStr.size()){
+			return false;
+		}
+		for(size_t cid = 0; cid < str.size(); ++cid){
+			if(lower(str[cid]) != lowerStr[cid]){
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// Case-insensitive search of an already lowercase string.
+	bool containsLower(const std::string & str, const std::string & lowerStr){
+		return std::search(str.begin(), str.end(), lowerStr.begin(), lowerStr.end(), [](char a, char b){
+			return lower(a) == b;
+		}) != str.end();
+	}
+
+}
+
+bool Filter::parse(const std::string & expression){
+	*this = Filter();
+	_expression = expression;
+
+	size_t pos = 0;
+	while(pos < expression.size()){
+		// Skip spaces between conditions.
+		if(expression[pos] == ' ' || expression[pos] == '\t'){
+			++pos;
+			continue;
+		}
+		// Field name.
+		const size_t fieldBegin = pos;
+		while(pos < expression.size() && std::isalpha(uchar(expression[pos]))){
+			++pos;
+		}
+		const std::string field = TextUtilities::lowercase(expression.substr(fieldBegin, pos - fieldBegin));
+
+		// Comparison operator, longest first.
+		static const std::vector<std::pair<std::string, Comparison>> comparisons = {
+			{">=", Comparison::GREATER_EQUAL}, {"<=", Comparison::LESS_EQUAL}, {"!=", Comparison::DIFFERENT}, {"!~", Comparison::EXCLUDES},
+			{">", Comparison::GREATER}, {"<", Comparison::LESS}, {"=", Comparison::EQUAL}, {"~", Comparison::CONTAINS},
+		};
+		bool foundComparison = false;
+		Comparison comparison = Comparison::EQUAL;
+		for(const auto & candidate : comparisons){
+			if(expression.compare(pos, candidate.first.size(), candidate.first) == 0){
+				comparison = candidate.second;
+				pos += candidate.first.size();
+				foundComparison = true;
+				break;
+			}
+		}
+		if(field.empty() || !foundComparison){
+			Log::Error() << "Invalid filter condition at \"" << expression.substr(fieldBegin) << "\"." << std::endl;
+			_valid = false;
+			return false;
+		}
+
+		// Value, either quoted or up to the next space.
+		std::string value;
+		if(pos < expression.size() && (expression[pos] == '"' || expression[pos] == '\'')){
+			const char quote = expression[pos];
+			const size_t valueEnd = expression.find(quote, pos + 1);
+			if(valueEnd == std::string::npos){
+				Log::Error() << "Missing closing quote in filter." << std::endl;
+				_valid = false;
+				return false;
+			}
+			value = expression.substr(pos + 1, valueEnd - pos - 1);
+			pos = valueEnd + 1;
+		} else {
+			const size_t valueBegin = pos;
+			while(pos < expression.size() && expression[pos] != ' ' && expression[pos] != '\t'){
+				++pos;
+			}
+			value = expression.substr(valueBegin, pos - valueBegin);
+		}
+
+		bool added = false;
+		if(field == "date"){
+			added = addDate(comparison, value);
+		} else if(field == "amount"){
+			added = addAmount(comparison, value);
+		} else if(field == "label" || field == "category"){
+			added = addText(comparison, value, field == "category");
+		} else {
+			Log::Error() << "Unknown filter field \"" << field << "\" (date, amount, label or category expected)." << std::endl;
+		}
+		if(!added){
+			_valid = false;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Filter::addDate(Comparison comparison, const std::string & value){
+	// Partial dates cover a range of days.
+	const auto parts = TextUtilities::split(value, value.find('-') != std::string::npos ? "-" : "/", true);
+	if(parts.empty() || parts.size() > 3 || parts[0].size() != 4 || !std::all_of(parts.begin(), parts.end(), [](const std::string & part){
+		return !part.empty() && part.size() <= 4 && std::all_of(part.begin(), part.end(), [](char c){ return c >= '0' && c <= '9'; });
+	})){
+		Log::Error() << "Invalid filter date \"" << value << "\" (YYYY[/MM[/DD]] expected)." << std::endl;
+		return false;
+	}
+	const int year = std::stoi(parts[0]);
+	const int month = parts.size() > 1 ? std::stoi(parts[1]) : 0;
+	const int day = parts.size() > 2 ? std::stoi(parts[2]) : 0;
+	const int first = year * 10000 + (month != 0 ? month : 1) * 100 + (day != 0 ? day : 1);
+	const int last = year * 10000 + (month != 0 ? month : 12) * 100 + (day != 0 ? day : 31);
+
+	switch(comparison){
+		case Comparison::LESS:
+			_maxDate = std::min(_maxDate, first - 1);
+			break;
+		case Comparison::LESS_EQUAL:
+			_maxDate = std::min(_maxDate, last);
+			break;
+		case Comparison::GREATER:
+			_minDate = std::max(_minDate, last + 1);
+			break;
+		case Comparison::GREATER_EQUAL:
+			_minDate = std::max(_minDate, first);
+			break;
+		case Comparison::EQUAL:
+			_minDate = std::max(_minDate, first);
+			_maxDate = std::min(_maxDate, last);
+			break;
+		case Comparison::DIFFERENT:
+			_excludedDates.emplace_back(first, last);
+			break;
+		default:
+			Log::Error() << "Dates can only be compared with <, <=, >, >=, = and !=." << std::endl;
+			return false;
+	}
+	return true;
+}
+
+bool Filter::addAmount(Comparison comparison, const std::string & value){
+	Amount amount = 0;
+	if(!Operation::parseSignedAmount(value, amount)){
+		Log::Error() << "Invalid filter amount \"" << value << "\"." << std::endl;
+		return false;
+	}
+	switch(comparison){
+		case Comparison::LESS:
+			_maxAmount = std::min(_maxAmount, amount - 1);
+			break;
+		case Comparison::LESS_EQUAL:
+			_maxAmount = std::min(_maxAmount, amount);
+			break;
+		case Comparison::GREATER:
+			_minAmount = std::max(_minAmount, amount + 1);
+			break;
+		case Comparison::GREATER_EQUAL:
+			_minAmount = std::max(_minAmount, amount);
+			break;
+		case Comparison::EQUAL:
+			_minAmount = std::max(_minAmount, amount);
+			_maxAmount = std::min(_maxAmount, amount);
+			break;
+		case Comparison::DIFFERENT:
+			_excludedAmounts.push_back(amount);
+			break;
+		default:
+			Log::Error() << "Amounts can only be compared with <, <=, >, >=, = and !=." << std::endl;
+			return false;
+	}
+	return true;
+}
+
+bool Filter::addText(Comparison comparison, const std::string & value, bool category){
+	std::string text(value);
+	std::transform(text.begin(), text.end(), text.begin(), lower);
+	switch(comparison){
+		case Comparison::CONTAINS:
+			_texts.push_back({text, category, true, false});
+			break;
+		case Comparison::EXCLUDES:
+			_texts.push_back({text, category, true, true});
+			break;
+		case Comparison::EQUAL:
+			_texts.push_back({text, category, false, false});
+			break;
+		case Comparison::DIFFERENT:
+			_texts.push_back({text, category, false, true});
+			break;
+		default:
+			Log::Error() << "Labels and categories can only be compared with ~, !~, = and !=." << std::endl;
+			return false;
+	}
+	return true;
+}
+
+bool Filter::matches(const Operation & operation) const {
+	// Dates and amounts first, they are cheap to compare.
+	const int date = operation.date().key();
+	if(date < _minDate || date > _maxDate){
+		return false;
+	}
+	for(const auto & range : _excludedDates){
+		if(date >= range.first && date <= range.second){
+			return false;
+		}
+	}
+	const Amount amount = operation.amount();
+	if(amount < _minAmount || amount > _maxAmount){
+		return false;
+	}
+	if(!_excludedAmounts.empty() && std::find(_excludedAmounts.begin(), _excludedAmounts.end(), amount) != _excludedAmounts.end()){
+		return false;
+	}
+	for(const TextCondition & condition : _texts){
+		const std::string & text = condition.category ? operation.category() : operation.label();
+		const bool satisfied = condition.contains ? containsLower(text, condition.text) : equalsLower(text, condition.text);
+		if(satisfied == condition.negate){
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Filter::empty() const {
+	return _minDate == 0 && _maxDate == 99991231 && _excludedDates.empty()
+		&& _minAmount == std::numeric_limits<Amount>::min() && _maxAmount == std::numeric_limits<Amount>::max()
+		&& _excludedAmounts.empty() && _texts.empty();
+}
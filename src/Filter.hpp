@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Common.hpp"
+#include "Operation.hpp"
+
+#include <limits>
+
+/**
+ \brief A compiled filter on operations, parsed from a list of conditions that must all be satisfied, such as
+ `date>=2023/01 amount<-50 label~"carrefour"`.
+ Dates can be partial (YYYY, YYYY/MM or YYYY/MM/DD) and cover the whole period they describe.
+ Amounts are signed. Labels and categories support containment (~, !~) and equality (=, !=), ignoring case.
+ Conditions are merged into date and amount ranges, checked before any text comparison.
+ */
+class Filter {
+public:
+
+	/** Parse a filter expression.
+	 \param expression the conditions, separated by spaces
+	 \return false if the expression is invalid
+	 */
+	bool parse(const std::string & expression);
+
+	/** Check if an operation satisfies all conditions.
+	 \param operation the operation to test
+	 \return true if the operation is kept
+	 */
+	bool matches(const Operation & operation) const;
+
+	/** \return true if the filter keeps all operations */
+	bool empty() const;
+
+	/** \return false if the last parsed expression was invalid */
+	bool valid() const { return _valid; }
+
+	/** \return the earliest date key (YYYYMMDD) that can be kept */
+	int minDate() const { return _minDate; }
+
+	/** \return the latest date key (YYYYMMDD) that can be kept */
+	int maxDate() const { return _maxDate; }
+
+	/** \return the parsed expression */
+	const std::string & expression() const { return _expression; }
+
+private:
+
+	enum class Comparison {
+		LESS, LESS_EQUAL, GREATER, GREATER_EQUAL, EQUAL, DIFFERENT, CONTAINS, EXCLUDES
+	};
+
+	bool addDate(Comparison comparison, const std::string & value);
+
+	bool addAmount(Comparison comparison, const std::string & value);
+
+	bool addText(Comparison comparison, const std::string & value, bool category);
+
+	struct TextCondition {
+		std::string text; ///< Lowercase text to look for.
+		bool category; ///< Test the category instead of the label.
+		bool contains; ///< Look for a substring instead of the full label.
+		bool negate; ///< Keep labels that don't satisfy the condition.
+	};
+
+	std::string _expression;
+	int _minDate = 0;
+	int _maxDate = 99991231;
+	std::vector<std::pair<int, int>> _excludedDates;
+	Amount _minAmount = std::numeric_limits<Amount>::min();
+	Amount _maxAmount = std::numeric_limits<Amount>::max();
+	std::vector<Amount> _excludedAmounts;
+	std::vector<TextCondition> _texts;
+	bool _valid = true;
+};
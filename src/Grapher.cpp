@@ -1,11 +1,14 @@
 #include "Grapher.hpp"
 #include "system/Terminal.hpp"
 #include "system/TextUtilities.hpp"
+#include "system/Profiler.hpp"
 
 #include <map>
 #include <sstream>
 
 void Grapher::graphMonths(const std::vector<Totals> & months, const Totals & totals, int height){
+	Profiler::Scope scope("Render graph");
+	scope.count(months.size());
 
 	const size_t mCount = months.size();
 
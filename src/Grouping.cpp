@@ -0,0 +1,194 @@
+#include "Grouping.hpp"
+#include "system/TextUtilities.hpp"
+#include "system/Profiler.hpp"
+
+#include <unordered_map>
+#include <map>
+
+namespace {
+
+	using GroupMap = std::unordered_map<std::string, Grouping::Group>;
+
+	const char keySeparator = '\x1f';
+
+	std::string dateString(const Date & date, size_t length){
+		char buffer[16];
+		const size_t size = date.write(Date::Format::YearMonthDay, buffer);
+		return std::string(buffer, std::min(size, length));
+	}
+
+	/// Hashtags of a label, lowercase.
+	std::vector<std::string> tags(const std::string & label){
+		std::vector<std::string> result;
+		size_t pos = label.find('#');
+		while(pos != std::string::npos){
+			size_t end = pos + 1;
+			while(end < label.size() && (std::isalnum(uchar(label[end])) || label[end] == '_' || label[end] == '-' || uchar(label[end]) >= 128)){
+				++end;
+			}
+			if(end > pos + 1){
+				const std::string tag = TextUtilities::lowercase(label.substr(pos, end - pos));
+				if(std::find(result.begin(), result.end(), tag) == result.end()){
+					result.push_back(tag);
+				}
+			}
+			pos = label.find('#', end);
+		}
+		if(result.empty()){
+			result.emplace_back("-");
+		}
+		return result;
+	}
+
+	void accumulate(GroupMap & groups, const Operation & operation, const std::vector<Grouping::Key> & keys){
+		std::vector<std::vector<std::string>> keyValues;
+		keyValues.reserve(keys.size());
+		for(const Grouping::Key key : keys){
+			keyValues.push_back(Grouping::keyValues(operation, key));
+		}
+		Grouping::Group single;
+		single.count = 1;
+		single.min = single.max = operation.amount();
+		if(operation.type() == Operation::Type::In){
+			single.totals.first = operation.amount();
+		} else {
+			single.totals.second = operation.amount();
+		}
+
+		// Visit each combination of values (only tags can have multiple values).
+		std::vector<size_t> choice(keys.size(), 0);
+		while(true){
+			std::string id;
+			for(size_t kid = 0; kid < keys.size(); ++kid){
+				id += keyValues[kid][choice[kid]];
+				id += keySeparator;
+			}
+			auto entry = groups.find(id);
+			if(entry == groups.end()){
+				Grouping::Group & group = groups[id];
+				group = single;
+				for(size_t kid = 0; kid < keys.size(); ++kid){
+					group.keys.push_back(keyValues[kid][choice[kid]]);
+				}
+			} else {
+				entry->second.merge(single);
+			}
+			// Next combination.
+			size_t kid = 0;
+			for(; kid < keys.size(); ++kid){
+				if(++choice[kid] < keyValues[kid].size()){
+					break;
+				}
+				choice[kid] = 0;
+			}
+			if(kid == keys.size()){
+				break;
+			}
+		}
+	}
+}
+
+std::vector<std::string> Grouping::keyValues(const Operation & operation, Key key){
+	switch(key){
+		case Key::DAY:
+			return {dateString(operation.date(), 10)};
+		case Key::WEEK: {
+			// 1970/01/01 was a Thursday.
+			const long day = operation.date().dayNumber();
+			const long weekDay = ((day + 3) % 7 + 7) % 7;
+			return {dateString(Date::fromDayNumber(day - weekDay), 10)};
+		}
+		case Key::MONTH:
+			return {dateString(operation.date(), 7)};
+		case Key::YEAR:
+			return {dateString(operation.date(), 4)};
+		case Key::LABEL:
+			return {TextUtilities::normalize(operation.label())};
+		case Key::TAG:
+			return tags(operation.label());
+		case Key::CATEGORY:
+			return {operation.category().empty() ? std::string("-") : operation.category()};
+	}
+	return {};
+}
+
+Amount Grouping::Group::mean() const {
+	return count == 0 ? Amount(0) : (totals.first + totals.second) / Amount(count);
+}
+
+void Grouping::Group::merge(const Group & other){
+	if(other.count == 0){
+		return;
+	}
+	min = count == 0 ? other.min : std::min(min, other.min);
+	max = count == 0 ? other.max : std::max(max, other.max);
+	totals.first += other.totals.first;
+	totals.second += other.totals.second;
+	count += other.count;
+}
+
+bool Grouping::keyFromString(const std::string & name, Key & key){
+	static const std::vector<std::pair<std::string, Key>> names = {
+		{"day", Key::DAY}, {"week", Key::WEEK}, {"month", Key::MONTH}, {"year", Key::YEAR}, {"label", Key::LABEL}, {"tag", Key::TAG}, {"category", Key::CATEGORY}
+	};
+	const std::string nameLow = TextUtilities::lowercase(name);
+	for(const auto & candidate : names){
+		if(candidate.first == nameLow){
+			key = candidate.second;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Grouping::isPeriod(Key key){
+	return key != Key::LABEL && key != Key::TAG && key != Key::CATEGORY;
+}
+
+std::string Grouping::keyName(Key key){
+	static const std::vector<std::string> names = {"Day", "Week", "Month", "Year", "Label", "Tag", "Category"};
+	return names[size_t(key)];
+}
+
+std::vector<Grouping::Group> Grouping::compute(const Listing & list, const std::vector<Key> & keys, const Filter & filter){
+	Profiler::Scope scope("Group");
+	scope.count(size_t(list.count()));
+	// Split operations in one block per thread, each aggregated separately.
+	const long count = list.count();
+	const long threadCount = long(std::max(1u, std::thread::hardware_concurrency()));
+	const long blockCount = std::max(std::min(threadCount, count / 4096), 1l);
+	const long blockSize = (count + blockCount - 1) / blockCount;
+	std::vector<GroupMap> partials(blockCount);
+
+	System::forParallel(size_t(blockCount), [&](size_t bid){
+		const long begin = long(bid) * blockSize;
+		const long end = std::min(begin + blockSize, count);
+		GroupMap & groups = partials[bid];
+		for(long oid = begin; oid < end; ++oid){
+			const Operation & operation = list.operation(oid);
+			if(filter.matches(operation)){
+				accumulate(groups, operation, keys);
+			}
+		}
+	});
+
+	// Merge partial groups, ordered by keys.
+	std::map<std::string, Group> merged;
+	for(GroupMap & groups : partials){
+		for(auto & entry : groups){
+			auto existing = merged.find(entry.first);
+			if(existing == merged.end()){
+				merged.emplace(entry.first, std::move(entry.second));
+			} else {
+				existing->second.merge(entry.second);
+			}
+		}
+		groups.clear();
+	}
+	std::vector<Group> result;
+	result.reserve(merged.size());
+	for(auto & entry : merged){
+		result.push_back(std::move(entry.second));
+	}
+	return result;
+}
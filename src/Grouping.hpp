@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Common.hpp"
+#include "Listing.hpp"
+#include "Filter.hpp"
+
+/**
+ \brief Aggregate the operations of a listing in groups sharing the same period, label, tags or category.
+ Operations are processed in parallel, each thread filling its own groups that are merged at the end.
+ */
+class Grouping {
+public:
+
+	/// Properties used to group operations.
+	enum class Key {
+		DAY, ///< Day of the operation (YYYY/MM/DD).
+		WEEK, ///< First day of the week (YYYY/MM/DD), weeks start on Monday.
+		MONTH, ///< Month of the operation (YYYY/MM).
+		YEAR, ///< Year of the operation (YYYY).
+		LABEL, ///< Normalized label.
+		TAG, ///< Each hashtag in the label (#tag), an operation can belong to multiple groups.
+		CATEGORY ///< Category assigned by the listing rules.
+	};
+
+	/// Aggregated values of a group of operations.
+	struct Group {
+		std::vector<std::string> keys; ///< Value of each grouping key.
+		Totals totals = {Amount(0), Amount(0)};
+		long count = 0;
+		Amount min = 0;
+		Amount max = 0;
+
+		/** \return the average amount */
+		Amount mean() const;
+
+		/** Merge another group with the same keys.
+		 \param other the group to merge
+		 */
+		void merge(const Group & other);
+	};
+
+	/** Find a key from its name.
+	 \param name the key name (day, week, month, year, label, tag or category)
+	 \param key will contain the key
+	 \return true if the name is known
+	 */
+	static bool keyFromString(const std::string & name, Key & key);
+
+	/** \return the name of a key */
+	static std::string keyName(Key key);
+
+	/** \return true if the key is a period of time */
+	static bool isPeriod(Key key);
+
+	/** Compute the value of a key for an operation.
+	 \param operation the operation
+	 \param key the property to use
+	 \return the values of the key (tags can have none or multiple values)
+	 */
+	static std::vector<std::string> keyValues(const Operation & operation, Key key);
+
+	/** Aggregate the operations satisfying a filter.
+	 \param list the listing
+	 \param keys the properties to group operations by
+	 \param filter the operations to consider
+	 \return the groups, sorted by keys
+	 */
+	static std::vector<Group> compute(const Listing & list, const std::vector<Key> & keys, const Filter & filter);
+
+};
@@ -0,0 +1,535 @@
+#include "Importer.hpp"
+#include "system/TextUtilities.hpp"
+#include "system/Profiler.hpp"
+
+#include <chrono>
+#include <atomic>
+
+namespace {
+
+	/// Parse a date with day first (DD/MM/YY[YY]) or year first (YYYY-MM-DD, YYYYMMDD) ordering.
+	bool parseDate(const std::string & str, Date & date){
+		// Collect groups of digits, whatever the separators.
+		std::vector<std::string> groups;
+		std::string group;
+		for(const char c : str){
+			if(c >= '0' && c <= '9'){
+				group += c;
+			} else if(!group.empty()){
+				groups.push_back(group);
+				group.clear();
+			}
+		}
+		if(!group.empty()){
+			groups.push_back(group);
+		}
+		if(groups.empty()){
+			return false;
+		}
+
+		int year = 0;
+		int month = 0;
+		int day = 0;
+		if(groups[0].size() >= 8){
+			// Compact YYYYMMDD, possibly followed by a time.
+			year = std::stoi(groups[0].substr(0, 4));
+			month = std::stoi(groups[0].substr(4, 2));
+			day = std::stoi(groups[0].substr(6, 2));
+		} else if(groups.size() >= 3 && groups[0].size() <= 4 && groups[1].size() <= 2 && groups[2].size() <= 4){
+			if(groups[0].size() == 4){
+				year = std::stoi(groups[0]);
+				month = std::stoi(groups[1]);
+				day = std::stoi(groups[2]);
+			} else {
+				day = std::stoi(groups[0]);
+				month = std::stoi(groups[1]);
+				year = std::stoi(groups[2]);
+			}
+			if(groups[2].size() <= 2 && groups[0].size() != 4){
+				year += year < 70 ? 2000 : 1900;
+			}
+		} else {
+			return false;
+		}
+		if(month < 1 || month > 12 || day < 1 || day > 31){
+			return false;
+		}
+		date = Date(year, month, day);
+		return true;
+	}
+
+	/// Labels are stored on a single line, separated from the amount by a tabulation.
+	std::string cleanLabel(const std::string & str){
+		std::string label;
+		label.reserve(str.size());
+		for(const char c : str){
+			const bool space = c == ' ' || c == '\t' || c == '\r' || c == '\n';
+			if(space){
+				if(!label.empty() && label.back() != ' '){
+					label += ' ';
+				}
+			} else {
+				label += c;
+			}
+		}
+		if(!label.empty() && label.back() == ' '){
+			label.pop_back();
+		}
+		return label.empty() ? "Unknown" : label;
+	}
+
+	/// Common state for all line parsers.
+	class Parser {
+	public:
+
+		explicit Parser(std::vector<Operation> & operations) : _operations(operations) {}
+
+		virtual ~Parser() = default;
+
+		virtual void line(const std::string & line) = 0;
+
+		virtual void finish() {}
+
+		bool failed() const {
+			return _failed;
+		}
+
+		size_t skipped() const {
+			return _skipped;
+		}
+
+	protected:
+
+		void add(const std::string & dateStr, const std::string & amountStr, const std::string & label){
+			Date date;
+			Amount amount = 0;
+			if(!parseDate(dateStr, date) || !Operation::parseSignedAmount(amountStr, amount)){
+				++_skipped;
+				return;
+			}
+			_operations.emplace_back(amount, cleanLabel(label), date);
+		}
+
+		std::vector<Operation> & _operations;
+		size_t _skipped = 0;
+		bool _failed = false;
+	};
+
+	/// Deben listings, as saved by Deben.
+	class DebenParser : public Parser {
+	public:
+
+		using Parser::Parser;
+
+		void line(const std::string & line) override {
+			const std::string lineClean = TextUtilities::trim(line, "\t ");
+			if(lineClean.empty() || lineClean[0] == '#'){
+				return;
+			}
+			const auto toks = TextUtilities::split(lineClean, "\t", true);
+			if(toks.size() < 2){
+				++_skipped;
+				return;
+			}
+			try {
+				_operations.emplace_back(toks);
+			} catch(const std::exception &){
+				++_skipped;
+			}
+		}
+	};
+
+	/// Comma/semicolon separated values, with or without a header.
+	class CSVParser : public Parser {
+	public:
+
+		using Parser::Parser;
+
+		void line(const std::string & line) override {
+			if(_failed || TextUtilities::trim(line, "\t ").empty()){
+				return;
+			}
+			if(_delimiter == '\0'){
+				detectDelimiter(line);
+			}
+			split(line);
+			if(!_columnsFound && !findColumns()){
+				return;
+			}
+			record();
+		}
+
+	private:
+
+		void detectDelimiter(const std::string & line){
+			// Use the most frequent candidate outside of quotes.
+			size_t counts[3] = {0, 0, 0};
+			const char candidates[3] = {';', ',', '\t'};
+			bool quoted = false;
+			for(const char c : line){
+				quoted = c == '"' ? !quoted : quoted;
+				for(size_t cid = 0; cid < 3 && !quoted; ++cid){
+					counts[cid] += c == candidates[cid] ? 1 : 0;
+				}
+			}
+			const size_t best = size_t(std::max_element(counts, counts + 3) - counts);
+			_delimiter = candidates[best];
+		}
+
+		void split(const std::string & line){
+			_fields.clear();
+			std::string field;
+			bool quoted = false;
+			for(size_t i = 0; i < line.size(); ++i){
+				const char c = line[i];
+				if(quoted){
+					if(c == '"' && i + 1 < line.size() && line[i+1] == '"'){
+						field += '"';
+						++i;
+					} else if(c == '"'){
+						quoted = false;
+					} else {
+						field += c;
+					}
+				} else if(c == '"'){
+					quoted = true;
+				} else if(c == _delimiter){
+					_fields.push_back(TextUtilities::trim(field, " \r"));
+					field.clear();
+				} else {
+					field += c;
+				}
+			}
+			_fields.push_back(TextUtilities::trim(field, " \r"));
+		}
+
+		bool findColumns(){
+			_columnsFound = true;
+			Date date;
+			const bool header = std::none_of(_fields.begin(), _fields.end(), [&date](const std::string & field){
+				return parseDate(field, date);
+			});
+
+			if(!header){
+				// Guess columns from the first record: a date, then an amount, the rest is the label.
+				for(int fid = 0; fid < int(_fields.size()); ++fid){
+					Amount amount;
+					if(_date < 0 && parseDate(_fields[fid], date)){
+						_date = fid;
+					} else if(_amount < 0 && Operation::parseSignedAmount(_fields[fid], amount)){
+						_amount = fid;
+					}
+				}
+			} else {
+				const auto contains = [](const std::string & name, const std::vector<std::string> & keys){
+					return std::any_of(keys.begin(), keys.end(), [&name](const std::string & key){
+						return name.find(key) != std::string::npos;
+					});
+				};
+				for(int fid = 0; fid < int(_fields.size()); ++fid){
+					const std::string name = TextUtilities::lowercase(_fields[fid]);
+					int * column = nullptr;
+					if(contains(name, {"date"})){
+						column = &_date;
+					} else if(contains(name, {"debit", "d\xc3\xa9" "bit", "withdrawal"})){
+						column = &_debit;
+					} else if(contains(name, {"credit", "cr\xc3\xa9" "dit", "deposit"})){
+						column = &_credit;
+					} else if(contains(name, {"amount", "montant", "betrag", "importe"})){
+						column = &_amount;
+					} else if(contains(name, {"label", "libell", "descr", "memo", "name", "payee", "wording", "intitul", "detail"})){
+						column = &_label;
+					}
+					// Keep the first matching column.
+					if(column && *column < 0){
+						*column = fid;
+					}
+				}
+			}
+
+			if(_date < 0 || (_amount < 0 && _debit < 0 && _credit < 0)){
+				Log::Error() << Log::Load << "Unable to find the date and amount columns." << std::endl;
+				_failed = true;
+			}
+			// Only process the first line if it contains values.
+			return !header && !_failed;
+		}
+
+		void record(){
+			const auto field = [this](int column) -> std::string {
+				return (column >= 0 && column < int(_fields.size())) ? _fields[column] : std::string();
+			};
+
+			std::string amountStr = field(_amount);
+			if(_amount < 0){
+				// Separate columns, debits might be written without a sign.
+				const std::string credit = field(_credit);
+				const std::string debit = field(_debit);
+				Amount value = 0;
+				if(!credit.empty() && Operation::parseSignedAmount(credit, value) && value != 0){
+					amountStr = Operation::writeAmount(std::abs(value));
+				} else if(!debit.empty() && Operation::parseSignedAmount(debit, value)){
+					amountStr = Operation::writeAmount(-std::abs(value));
+				}
+			}
+
+			std::string label = field(_label);
+			if(_label < 0){
+				// Use all other columns.
+				for(int fid = 0; fid < int(_fields.size()); ++fid){
+					if(fid != _date && fid != _amount && fid != _debit && fid != _credit && !_fields[fid].empty()){
+						label += (label.empty() ? "" : " ") + _fields[fid];
+					}
+				}
+			}
+			add(field(_date), amountStr, label);
+		}
+
+		std::vector<std::string> _fields;
+		char _delimiter = '\0';
+		bool _columnsFound = false;
+		int _date = -1;
+		int _amount = -1;
+		int _debit = -1;
+		int _credit = -1;
+		int _label = -1;
+	};
+
+	/// Open Financial Exchange statements, SGML or XML.
+	class OFXParser : public Parser {
+	public:
+
+		using Parser::Parser;
+
+		void line(const std::string & line) override {
+			// Tags can be split on multiple lines or all be on the same one.
+			std::string::size_type pos = line.find('<');
+			while(pos != std::string::npos){
+				const std::string::size_type tagEnd = line.find('>', pos);
+				if(tagEnd == std::string::npos){
+					return;
+				}
+				const std::string tag = TextUtilities::trim(line.substr(pos + 1, tagEnd - pos - 1), " ");
+				pos = line.find('<', tagEnd);
+				const std::string value = TextUtilities::trim(line.substr(tagEnd + 1, pos == std::string::npos ? std::string::npos : pos - tagEnd - 1), " \t\r");
+				process(tag, value);
+			}
+		}
+
+		void finish() override {
+			if(_inTransaction){
+				endTransaction();
+			}
+		}
+
+	private:
+
+		static std::string decode(std::string str){
+			TextUtilities::replace(str, "&lt;", "<");
+			TextUtilities::replace(str, "&gt;", ">");
+			TextUtilities::replace(str, "&quot;", "\"");
+			TextUtilities::replace(str, "&apos;", "'");
+			TextUtilities::replace(str, "&amp;", "&");
+			return str;
+		}
+
+		void process(const std::string & tag, const std::string & value){
+			if(tag == "STMTTRN"){
+				finish();
+				_inTransaction = true;
+				return;
+			}
+			if(tag == "/STMTTRN"){
+				finish();
+				return;
+			}
+			if(!_inTransaction){
+				return;
+			}
+			if(tag == "DTPOSTED"){
+				_dateStr = value;
+			} else if(tag == "TRNAMT"){
+				_amountStr = value;
+			} else if(tag == "NAME"){
+				_name = decode(value);
+			} else if(tag == "MEMO"){
+				_memo = decode(value);
+			}
+		}
+
+		void endTransaction(){
+			add(_dateStr, _amountStr, _name.empty() ? _memo : _name);
+			_inTransaction = false;
+			_dateStr.clear();
+			_amountStr.clear();
+			_name.clear();
+			_memo.clear();
+		}
+
+		bool _inTransaction = false;
+		std::string _dateStr;
+		std::string _amountStr;
+		std::string _name;
+		std::string _memo;
+	};
+
+	/// Quicken Interchange Format, one field per line.
+	class QIFParser : public Parser {
+	public:
+
+		using Parser::Parser;
+
+		void line(const std::string & line) override {
+			const std::string lineClean = TextUtilities::trim(line, " \t\r");
+			if(lineClean.empty() || lineClean[0] == '!'){
+				return;
+			}
+			const char code = lineClean[0];
+			const std::string value = lineClean.substr(1);
+			if(code == '^'){
+				finish();
+			} else if(code == 'D'){
+				_dateStr = value;
+			} else if(code == 'T' || code == 'U'){
+				_amountStr = value;
+			} else if(code == 'P'){
+				_payee = value;
+			} else if(code == 'M'){
+				_memo = value;
+			}
+		}
+
+		void finish() override {
+			if(!_dateStr.empty() || !_amountStr.empty()){
+				add(_dateStr, _amountStr, _payee.empty() ? _memo : _payee);
+			}
+			_dateStr.clear();
+			_amountStr.clear();
+			_payee.clear();
+			_memo.clear();
+		}
+
+	private:
+
+		std::string _dateStr;
+		std::string _amountStr;
+		std::string _payee;
+		std::string _memo;
+	};
+
+}
+
+Importer::Format Importer::detectFormat(const fs::path & path){
+	const std::string ext = TextUtilities::lowercase(path.extension().string());
+	if(ext == ".csv"){
+		return Format::CSV;
+	}
+	if(ext == ".ofx" || ext == ".qfx"){
+		return Format::OFX;
+	}
+	if(ext == ".qif"){
+		return Format::QIF;
+	}
+	if(ext == ".txt"){
+		return Format::DEBEN;
+	}
+	// Look at the first non-empty line.
+	fs::ifstream file(path);
+	std::string line;
+	while(std::getline(file, line)){
+		line = TextUtilities::trim(line, " \t\r");
+		if(!line.empty()){
+			break;
+		}
+	}
+	if(TextUtilities::hasPrefix(line, "OFXHEADER") || TextUtilities::hasPrefix(line, "<OFX") || TextUtilities::hasPrefix(line, "<?xml")){
+		return Format::OFX;
+	}
+	if(TextUtilities::hasPrefix(line, "!")){
+		return Format::QIF;
+	}
+	if(line.find('\t') != std::string::npos && (line[0] == '#' || (line[0] >= '0' && line[0] <= '9'))){
+		return Format::DEBEN;
+	}
+	return Format::CSV;
+}
+
+bool Importer::formatFromString(const std::string & name, Format & format){
+	const std::string nameLow = TextUtilities::lowercase(name);
+	if(nameLow == "txt" || nameLow == "deben"){
+		format = Format::DEBEN;
+	} else if(nameLow == "csv"){
+		format = Format::CSV;
+	} else if(nameLow == "ofx" || nameLow == "qfx"){
+		format = Format::OFX;
+	} else if(nameLow == "qif"){
+		format = Format::QIF;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+bool Importer::importFile(const fs::path & path, Format format, std::vector<Operation> & operations){
+	Profiler::Scope scope("Import file");
+	if(format == Format::AUTO){
+		format = detectFormat(path);
+	}
+	const size_t initialCount = operations.size();
+	std::unique_ptr<Parser> parser;
+	if(format == Format::CSV){
+		parser.reset(new CSVParser(operations));
+	} else if(format == Format::OFX){
+		parser.reset(new OFXParser(operations));
+	} else if(format == Format::QIF){
+		parser.reset(new QIFParser(operations));
+	} else {
+		parser.reset(new DebenParser(operations));
+	}
+
+	std::string line;
+	const bool read = System::forEachLine(path, [&parser, &line, &scope](const char * str, size_t size){
+		scope.count(0, size + 1);
+		line.assign(str, size);
+		parser->line(line);
+	});
+	parser->finish();
+
+	if(!read || parser->failed()){
+		operations.erase(operations.begin() + long(initialCount), operations.end());
+		return false;
+	}
+	scope.count(operations.size() - initialCount);
+	if(parser->skipped() != 0){
+		Log::Warning() << Log::Load << "Skipped " << parser->skipped() << " invalid records in " << path << "." << std::endl;
+	}
+	Log::Verbose() << Log::Load << "Read " << (operations.size() - initialCount) << " operations from " << path << "." << std::endl;
+	return true;
+}
+
+bool Importer::importDirectory(const fs::path & path, Format format, std::vector<std::vector<Operation>> & files){
+	const std::vector<fs::path> paths = System::listItems(path, true, false);
+	if(paths.empty()){
+		Log::Error() << Log::Load << "No file to import in " << path << "." << std::endl;
+		return false;
+	}
+
+	files.clear();
+	files.resize(paths.size());
+	std::vector<char> imported(paths.size(), 0);
+	std::atomic<size_t> processed(0);
+
+	System::forParallel(paths.size(), [&](size_t fid){
+		const auto start = std::chrono::steady_clock::now();
+		imported[fid] = importFile(paths[fid], format, files[fid]) ? 1 : 0;
+		const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+		const size_t rank = ++processed;
+		if(!imported[fid]){
+			Log::Error() << Log::Load << "Unable to import operations from " << paths[fid] << "." << std::endl;
+		}
+		Log::Verbose() << Log::Load << "[" << rank << "/" << paths.size() << "] " << paths[fid].filename() << ": " << files[fid].size() << " operations in " << duration.count() << "ms." << std::endl;
+	});
+
+	return std::find(imported.begin(), imported.end(), 1) != imported.end();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Common.hpp"
+#include "Operation.hpp"
+#include "system/System.hpp"
+
+/**
+ \brief Read operations from bank statement exports (CSV, OFX, QIF) or other Deben listings.
+ Files are read line by line, dates are expected to be day first (DD/MM/YYYY) or year first (YYYY-MM-DD).
+ */
+class Importer {
+public:
+
+	enum class Format {
+		DEBEN, CSV, OFX, QIF,
+		AUTO ///< Detect the format of each file.
+	};
+
+	/** Guess the format of a file from its extension, or from its first line.
+	 \param path the file to examine
+	 \return the most likely format
+	 */
+	static Format detectFormat(const fs::path & path);
+
+	/** Find a format from its name.
+	 \param name the format name ("txt", "csv", "ofx", "qif")
+	 \param format will contain the format
+	 \return true if the name is known
+	 */
+	static bool formatFromString(const std::string & name, Format & format);
+
+	/** Read the operations stored in a file.
+	 \param path the file to import
+	 \param format the file format
+	 \param operations will receive the imported operations
+	 \return false if the file couldn't be read or interpreted
+	 */
+	static bool importFile(const fs::path & path, Format format, std::vector<Operation> & operations);
+
+	/** Read the operations stored in all files of a directory and its subdirectories, in parallel.
+	 Files that can't be read or interpreted are reported and ignored.
+	 \param path the directory to import
+	 \param format the files format
+	 \param files will receive the imported operations of each file, sorted by file name
+	 \return false if no file could be imported
+	 */
+	static bool importDirectory(const fs::path & path, Format format, std::vector<std::vector<Operation>> & files);
+
+};
@@ -0,0 +1,448 @@
+#include "LabelIndex.hpp"
+#include "Listing.hpp"
+#include "system/Profiler.hpp"
+
+#include <unordered_map>
+
+namespace {
+
+	const char indexMagic[8] = {'D', 'E', 'B', 'E', 'N', 'I', 'D', 'X'};
+	const uint32_t indexVersion = 2;
+
+	char lower(char c){
+		return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+	}
+
+	uint32_t trigram(const char * str){
+		return (uint32_t(uchar(lower(str[0]))) << 16) | (uint32_t(uchar(lower(str[1]))) << 8) | uint32_t(uchar(lower(str[2])));
+	}
+
+	/// Case-insensitive search of an already lowercase string.
+	bool containsLower(const char * begin, const char * end, const std::string & lowerStr){
+		return std::search(begin, end, lowerStr.begin(), lowerStr.end(), [](char a, char b){
+			return lower(a) == b;
+		}) != end;
+	}
+
+	/// File size and modification time, to detect listing changes.
+	bool fileState(const fs::path & path, uint64_t & size, int64_t & time){
+		std::error_code ec;
+		size = uint64_t(fs::file_size(path, ec));
+		if(ec){
+			return false;
+		}
+		time = int64_t(fs::last_write_time(path, ec).time_since_epoch().count());
+		return !ec;
+	}
+
+	template<typename T>
+	void write(std::ostream & stream, const T & value){
+		stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+	template<typename T>
+	void write(std::ostream & stream, const std::vector<T> & values){
+		stream.write(reinterpret_cast<const char *>(values.data()), std::streamsize(values.size() * sizeof(T)));
+	}
+
+	template<typename T>
+	bool read(std::istream & stream, T & value){
+		return bool(stream.read(reinterpret_cast<char *>(&value), sizeof(T)));
+	}
+
+	template<typename T>
+	bool read(std::istream & stream, std::vector<T> & values, uint64_t count){
+		values.resize(size_t(count));
+		return bool(stream.read(reinterpret_cast<char *>(values.data()), std::streamsize(count * sizeof(T))));
+	}
+
+	/// Check that offsets start at 0, never decrease and end at the size of the data they point to.
+	template<typename T>
+	bool validOffsets(const std::vector<T> & offsets, uint64_t end){
+		if(offsets.empty() || offsets.front() != 0 || uint64_t(offsets.back()) != end){
+			return false;
+		}
+		return std::is_sorted(offsets.begin(), offsets.end());
+	}
+
+	/// Check that all label identifiers are valid.
+	bool validLabels(const std::vector<uint32_t> & labels, uint64_t labelCount){
+		return std::all_of(labels.begin(), labels.end(), [labelCount](uint32_t lid){
+			return lid < labelCount;
+		});
+	}
+
+}
+
+LabelIndex::LabelIndex(const Listing & list){
+	_operationCount = uint64_t(list.count());
+
+	// Collect distinct labels.
+	std::unordered_map<std::string, uint32_t> labelIds;
+	std::vector<const std::string *> labels;
+	_operationLabels.resize(_operationCount);
+	_dates.resize(_operationCount);
+	_amounts.resize(_operationCount);
+	for(long oid = 0; oid < list.count(); ++oid){
+		const Operation & ope = list.operation(oid);
+		const auto entry = labelIds.emplace(ope.label(), uint32_t(labels.size()));
+		if(entry.second){
+			labels.push_back(&entry.first->first);
+		}
+		_operationLabels[oid] = entry.first->second;
+		_dates[oid] = int32_t(ope.date().key());
+		_amounts[oid] = int64_t(ope.amount());
+	}
+
+	// Sort labels and renumber them.
+	std::vector<uint32_t> order(labels.size());
+	for(uint32_t lid = 0; lid < order.size(); ++lid){
+		order[lid] = lid;
+	}
+	std::sort(order.begin(), order.end(), [&labels](uint32_t a, uint32_t b){
+		return *labels[a] < *labels[b];
+	});
+	std::vector<uint32_t> rank(labels.size());
+	_labelOffsets.reserve(labels.size() + 1);
+	for(uint32_t lid = 0; lid < order.size(); ++lid){
+		rank[order[lid]] = lid;
+		_labelOffsets.push_back(_labelChars.size());
+		_labelChars += *labels[order[lid]];
+	}
+	_labelOffsets.push_back(_labelChars.size());
+	for(uint32_t & label : _operationLabels){
+		label = rank[label];
+	}
+
+	// Operations of each label, in chronological order.
+	_labelCounts.assign(labels.size(), 0);
+	for(const uint32_t label : _operationLabels){
+		++_labelCounts[label];
+	}
+	_labelOperationOffsets.assign(labels.size() + 1, 0);
+	for(size_t lid = 0; lid < labels.size(); ++lid){
+		_labelOperationOffsets[lid + 1] = _labelOperationOffsets[lid] + _labelCounts[lid];
+	}
+	_labelOperations.resize(_operationCount);
+	std::vector<uint32_t> positions(_labelOperationOffsets.begin(), _labelOperationOffsets.end() - 1);
+	for(uint32_t oid = 0; oid < _operationCount; ++oid){
+		_labelOperations[positions[_operationLabels[oid]]++] = oid;
+	}
+
+	buildTrigrams();
+}
+
+void LabelIndex::buildTrigrams(){
+	// Collect (trigram, label) pairs, then group them by trigram.
+	const size_t labelCount = _labelCounts.size();
+	std::vector<std::pair<uint32_t, uint32_t>> pairs;
+	std::vector<uint32_t> labelGrams;
+	for(uint32_t lid = 0; lid < labelCount; ++lid){
+		const char * str = _labelChars.data() + _labelOffsets[lid];
+		const size_t size = size_t(_labelOffsets[lid + 1] - _labelOffsets[lid]);
+		labelGrams.clear();
+		for(size_t cid = 0; cid + 2 < size; ++cid){
+			labelGrams.push_back(trigram(str + cid));
+		}
+		std::sort(labelGrams.begin(), labelGrams.end());
+		labelGrams.erase(std::unique(labelGrams.begin(), labelGrams.end()), labelGrams.end());
+		for(const uint32_t gram : labelGrams){
+			pairs.emplace_back(gram, lid);
+		}
+	}
+	std::sort(pairs.begin(), pairs.end());
+
+	_grams.clear();
+	_gramOffsets.clear();
+	_gramLabels.resize(pairs.size());
+	for(size_t pid = 0; pid < pairs.size(); ++pid){
+		if(_grams.empty() || _grams.back() != pairs[pid].first){
+			_grams.push_back(pairs[pid].first);
+			_gramOffsets.push_back(uint32_t(pid));
+		}
+		_gramLabels[pid] = pairs[pid].second;
+	}
+	_gramOffsets.push_back(uint32_t(pairs.size()));
+
+	// Order labels ignoring case, for prefix queries.
+	_lowercaseOrder.resize(labelCount);
+	for(uint32_t lid = 0; lid < labelCount; ++lid){
+		_lowercaseOrder[lid] = lid;
+	}
+	const char * chars = _labelChars.data();
+	std::sort(_lowercaseOrder.begin(), _lowercaseOrder.end(), [this, chars](uint32_t a, uint32_t b){
+		return std::lexicographical_compare(chars + _labelOffsets[a], chars + _labelOffsets[a + 1], chars + _labelOffsets[b], chars + _labelOffsets[b + 1], [](char x, char y){
+			return uchar(lower(x)) < uchar(lower(y));
+		});
+	});
+}
+
+std::string LabelIndex::label(uint32_t id) const {
+	return _labelChars.substr(size_t(_labelOffsets[id]), size_t(_labelOffsets[id + 1] - _labelOffsets[id]));
+}
+
+fs::path LabelIndex::indexPath(const fs::path & listingPath){
+	fs::path path = listingPath;
+	path += ".idx";
+	return path;
+}
+
+bool LabelIndex::save(const fs::path & listingPath) const {
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	if(!_file.empty() || !fileState(listingPath, sourceSize, sourceTime)){
+		return false;
+	}
+	// Write to a temporary file first, so that an interrupted save doesn't leave a partial index.
+	const fs::path path = indexPath(listingPath);
+	fs::path tempPath = path;
+	tempPath += ".tmp";
+	fs::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+	if(!file.is_open()){
+		Log::Error() << Log::Load << "Unable to write index to " << path << "." << std::endl;
+		return false;
+	}
+	file.write(indexMagic, sizeof(indexMagic));
+	write(file, indexVersion);
+	write(file, sourceSize);
+	write(file, sourceTime);
+	write(file, _operationCount);
+	write(file, uint64_t(_labelCounts.size()));
+	write(file, uint64_t(_labelChars.size()));
+	write(file, uint64_t(_grams.size()));
+	write(file, uint64_t(_gramLabels.size()));
+
+	write(file, _labelOffsets);
+	file.write(_labelChars.data(), std::streamsize(_labelChars.size()));
+	write(file, _labelCounts);
+	write(file, _lowercaseOrder);
+	write(file, _grams);
+	write(file, _gramOffsets);
+	write(file, _gramLabels);
+	write(file, _labelOperationOffsets);
+	// Operation data, only read on demand.
+	write(file, _labelOperations);
+	write(file, _dates);
+	write(file, _amounts);
+	write(file, _operationLabels);
+	file.close();
+
+	std::error_code ec;
+	if(file.fail()){
+		fs::remove(tempPath, ec);
+		Log::Error() << Log::Load << "Unable to write index to " << path << "." << std::endl;
+		return false;
+	}
+	fs::rename(tempPath, path, ec);
+	if(ec){
+		fs::remove(tempPath, ec);
+		Log::Error() << Log::Load << "Unable to write index to " << path << "." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool LabelIndex::load(const fs::path & listingPath, std::unique_ptr<LabelIndex> & index){
+	Profiler::Scope scope("Load label index");
+	const fs::path path = indexPath(listingPath);
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	uint64_t fileSize = 0;
+	int64_t fileTime = 0;
+	if(!System::isFile(path) || !fileState(listingPath, sourceSize, sourceTime) || !fileState(path, fileSize, fileTime)){
+		return false;
+	}
+	fs::ifstream file(path, std::ios::binary);
+	char magic[sizeof(indexMagic)];
+	uint32_t version = 0;
+	uint64_t indexedSize = 0;
+	int64_t indexedTime = 0;
+	if(!file.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), indexMagic)
+	   || !read(file, version) || version != indexVersion || !read(file, indexedSize) || !read(file, indexedTime)){
+		return false;
+	}
+	// The listing has been modified since.
+	if(indexedSize != sourceSize || indexedTime != sourceTime){
+		return false;
+	}
+
+	std::unique_ptr<LabelIndex> loaded(new LabelIndex());
+	uint64_t labelCount = 0;
+	uint64_t charCount = 0;
+	uint64_t gramCount = 0;
+	uint64_t gramLabelCount = 0;
+	if(!read(file, loaded->_operationCount) || !read(file, labelCount) || !read(file, charCount) || !read(file, gramCount) || !read(file, gramLabelCount)){
+		return false;
+	}
+	// Check that the file has the expected size before allocating anything, it could be truncated or corrupted.
+	const uint64_t opCount = loaded->_operationCount;
+	for(const uint64_t size : {opCount, labelCount, charCount, gramCount, gramLabelCount}){
+		if(size > fileSize){
+			return false;
+		}
+	}
+	const uint64_t headerSize = uint64_t(file.tellg());
+	const uint64_t labelsSize = (labelCount + 1) * sizeof(uint64_t) + charCount + labelCount * 2 * sizeof(uint32_t);
+	const uint64_t gramsSize = (2 * gramCount + 1 + gramLabelCount) * sizeof(uint32_t);
+	const uint64_t labelOperationsStart = headerSize + labelsSize + gramsSize + (labelCount + 1) * sizeof(uint32_t);
+	const uint64_t operationLabelsStart = labelOperationsStart + opCount * (sizeof(uint32_t) + sizeof(int32_t) + sizeof(int64_t));
+	if(fileSize != operationLabelsStart + opCount * sizeof(uint32_t)){
+		return false;
+	}
+
+	loaded->_labelChars.resize(size_t(charCount));
+	if(!read(file, loaded->_labelOffsets, labelCount + 1) || !file.read(&loaded->_labelChars[0], std::streamsize(charCount))
+	   || !read(file, loaded->_labelCounts, labelCount) || !read(file, loaded->_lowercaseOrder, labelCount) || !read(file, loaded->_grams, gramCount)
+	   || !read(file, loaded->_gramOffsets, gramCount + 1) || !read(file, loaded->_gramLabels, gramLabelCount)
+	   || !read(file, loaded->_labelOperationOffsets, labelCount + 1)){
+		return false;
+	}
+	if(!validOffsets(loaded->_labelOffsets, charCount) || !validOffsets(loaded->_gramOffsets, gramLabelCount)
+	   || !validOffsets(loaded->_labelOperationOffsets, opCount) || !validLabels(loaded->_lowercaseOrder, labelCount)
+	   || !validLabels(loaded->_gramLabels, labelCount)){
+		return false;
+	}
+	// Locate the operation data.
+	loaded->_file = path;
+	loaded->_labelOperationsStart = labelOperationsStart;
+	loaded->_datesStart = loaded->_labelOperationsStart + opCount * sizeof(uint32_t);
+	loaded->_amountsStart = loaded->_datesStart + opCount * sizeof(int32_t);
+	loaded->_operationLabelsStart = loaded->_amountsStart + opCount * sizeof(int64_t);
+	index = std::move(loaded);
+	return true;
+}
+
+template<typename T>
+void LabelIndex::fetch(size_t offset, size_t count, const std::vector<T> & section, uint64_t sectionStart, T * dst) const {
+	if(_file.empty()){
+		std::copy(section.begin() + long(offset), section.begin() + long(offset + count), dst);
+		return;
+	}
+	if(!_stream){
+		_stream.reset(new fs::ifstream(_file, std::ios::binary));
+	}
+	_stream->clear();
+	_stream->seekg(std::streamoff(sectionStart + offset * sizeof(T)));
+	if(!_stream->read(reinterpret_cast<char *>(dst), std::streamsize(count * sizeof(T)))){
+		std::fill(dst, dst + count, T(0));
+	}
+}
+
+std::vector<uint32_t> LabelIndex::matchingLabels(const std::string & text) const {
+	const size_t labelCount = _labelCounts.size();
+	const auto verify = [this, &text](uint32_t lid){
+		return containsLower(_labelChars.data() + _labelOffsets[lid], _labelChars.data() + _labelOffsets[lid + 1], text);
+	};
+
+	std::vector<uint32_t> labels;
+	// Short texts can't use trigrams.
+	if(text.size() < 3){
+		for(uint32_t lid = 0; lid < labelCount; ++lid){
+			if(verify(lid)){
+				labels.push_back(lid);
+			}
+		}
+		return labels;
+	}
+
+	// Gather the postings of all query trigrams, shortest first.
+	std::vector<std::pair<uint32_t, uint32_t>> postings;
+	for(size_t cid = 0; cid + 2 < text.size(); ++cid){
+		const uint32_t gram = trigram(text.data() + cid);
+		const auto it = std::lower_bound(_grams.begin(), _grams.end(), gram);
+		if(it == _grams.end() || *it != gram){
+			return labels;
+		}
+		const size_t gid = size_t(it - _grams.begin());
+		postings.emplace_back(_gramOffsets[gid], _gramOffsets[gid + 1]);
+	}
+	std::sort(postings.begin(), postings.end(), [](const std::pair<uint32_t, uint32_t> & a, const std::pair<uint32_t, uint32_t> & b){
+		return (a.second - a.first) < (b.second - b.first);
+	});
+	postings.erase(std::unique(postings.begin(), postings.end()), postings.end());
+
+	labels.assign(_gramLabels.begin() + postings[0].first, _gramLabels.begin() + postings[0].second);
+	std::vector<uint32_t> intersection;
+	for(size_t pid = 1; pid < postings.size() && !labels.empty(); ++pid){
+		intersection.clear();
+		std::set_intersection(labels.begin(), labels.end(), _gramLabels.begin() + postings[pid].first, _gramLabels.begin() + postings[pid].second, std::back_inserter(intersection));
+		labels.swap(intersection);
+	}
+	// Trigrams can appear in another order, check the full text.
+	labels.erase(std::remove_if(labels.begin(), labels.end(), [&verify](uint32_t lid){
+		return !verify(lid);
+	}), labels.end());
+	return labels;
+}
+
+std::vector<long> LabelIndex::search(const std::string & text) const {
+	Profiler::Scope scope("Search");
+	std::string textLow(text);
+	std::transform(textLow.begin(), textLow.end(), textLow.begin(), lower);
+
+	std::vector<long> operations;
+	std::vector<uint32_t> ids;
+	for(const uint32_t lid : matchingLabels(textLow)){
+		const size_t begin = _labelOperationOffsets[lid];
+		const size_t count = _labelOperationOffsets[lid + 1] - begin;
+		ids.resize(count);
+		fetch(begin, count, _labelOperations, _labelOperationsStart, ids.data());
+		operations.insert(operations.end(), ids.begin(), ids.end());
+	}
+	std::sort(operations.begin(), operations.end());
+	scope.count(operations.size());
+	return operations;
+}
+
+Operation LabelIndex::operation(long id) const {
+	int32_t date = 0;
+	int64_t amount = 0;
+	uint32_t label = 0;
+	fetch(size_t(id), 1, _dates, _datesStart, &date);
+	fetch(size_t(id), 1, _amounts, _amountsStart, &amount);
+	fetch(size_t(id), 1, _operationLabels, _operationLabelsStart, &label);
+	const std::string labelStr = label < _labelCounts.size() ? this->label(label) : std::string();
+	return Operation(Amount(amount), labelStr, Date(date / 10000, (date / 100) % 100, date % 100));
+}
+
+std::vector<std::string> LabelIndex::complete(const std::string & prefix, size_t count) const {
+	std::string prefixLow(prefix);
+	std::transform(prefixLow.begin(), prefixLow.end(), prefixLow.begin(), lower);
+
+	// Compare the beginning of a label with the prefix.
+	const char * chars = _labelChars.data();
+	const auto compare = [this, chars, &prefixLow](uint32_t lid){
+		const char * str = chars + _labelOffsets[lid];
+		const size_t size = size_t(_labelOffsets[lid + 1] - _labelOffsets[lid]);
+		for(size_t cid = 0; cid < prefixLow.size(); ++cid){
+			if(cid == size){
+				return -1;
+			}
+			const uchar a = uchar(lower(str[cid]));
+			const uchar b = uchar(prefixLow[cid]);
+			if(a != b){
+				return a < b ? -1 : 1;
+			}
+		}
+		return 0;
+	};
+	const auto begin = std::partition_point(_lowercaseOrder.begin(), _lowercaseOrder.end(), [&compare](uint32_t lid){
+		return compare(lid) < 0;
+	});
+	const auto end = std::partition_point(begin, _lowercaseOrder.end(), [&compare](uint32_t lid){
+		return compare(lid) == 0;
+	});
+
+	// Keep the most used labels.
+	std::vector<uint32_t> candidates(begin, end);
+	const size_t kept = std::min(count, candidates.size());
+	std::partial_sort(candidates.begin(), candidates.begin() + long(kept), candidates.end(), [this](uint32_t a, uint32_t b){
+		return _labelCounts[a] != _labelCounts[b] ? _labelCounts[a] > _labelCounts[b] : a < b;
+	});
+	std::vector<std::string> labels;
+	labels.reserve(kept);
+	for(size_t cid = 0; cid < kept; ++cid){
+		labels.push_back(label(candidates[cid]));
+	}
+	return labels;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Common.hpp"
+#include "Operation.hpp"
+#include "system/System.hpp"
+
+#include <cstdint>
+
+class Listing;
+
+/**
+ \brief Index of the labels of a listing, for substring search.
+ Distinct labels are stored once, sorted, along with the operations using them. Each trigram of the lowercase labels
+ points to the labels containing it, so that a search only verifies labels containing all trigrams of the query.
+ Labels are also sorted ignoring case, to find the ones beginning with a prefix by binary search.
+ The index can be saved next to the listing (<path>.idx) and reloaded without parsing the listing;
+ in that case, the operations of a label are only read from the file when needed.
+ */
+class LabelIndex {
+public:
+
+	/** Index all operations of a listing.
+	 \param list the listing
+	 */
+	explicit LabelIndex(const Listing & list);
+
+	/** Load an index saved next to a listing, if it is still up to date.
+	 \param listingPath the listing file
+	 \param index will contain the loaded index
+	 \return false if there is no index or if the listing has been modified since
+	 */
+	static bool load(const fs::path & listingPath, std::unique_ptr<LabelIndex> & index);
+
+	/** Save the index next to a listing.
+	 \param listingPath the listing file, used to detect later modifications
+	 \return false if the index couldn't be written
+	 */
+	bool save(const fs::path & listingPath) const;
+
+	/** Find operations whose label contains a text, ignoring case.
+	 \param text the text to look for
+	 \return the indices of the matching operations, in chronological order
+	 */
+	std::vector<long> search(const std::string & text) const;
+
+	/** Find the labels beginning with a prefix, ignoring case, the most used first.
+	 \param prefix the beginning of the labels
+	 \param count the maximum number of labels to return
+	 \return the labels
+	 */
+	std::vector<std::string> complete(const std::string & prefix, size_t count) const;
+
+	/** Retrieve an indexed operation.
+	 \param id the operation index
+	 \return the operation, with its date, amount and label
+	 */
+	Operation operation(long id) const;
+
+	/** \return the number of indexed operations */
+	long count() const { return long(_operationCount); }
+
+	/** \return the path to the index of a listing */
+	static fs::path indexPath(const fs::path & listingPath);
+
+private:
+
+	LabelIndex() = default;
+
+	/** Fill the trigram postings and the case-insensitive order from the labels. */
+	void buildTrigrams();
+
+	/** \return a label */
+	std::string label(uint32_t id) const;
+
+	/** Find the labels containing a text.
+	 \param text the lowercase text
+	 \return the label indices, sorted
+	 */
+	std::vector<uint32_t> matchingLabels(const std::string & text) const;
+
+	/** Read operation data, either from memory or from the index file.
+	 \param offset first element index in the section
+	 \param count number of elements
+	 \param section the section in memory
+	 \param sectionStart the section position in the file
+	 \param dst the destination
+	 */
+	template<typename T>
+	void fetch(size_t offset, size_t count, const std::vector<T> & section, uint64_t sectionStart, T * dst) const;
+
+	// Distinct labels, sorted.
+	std::vector<uint64_t> _labelOffsets; ///< Start of each label in the characters, and end of the last one.
+	std::string _labelChars;
+	std::vector<uint32_t> _labelCounts; ///< Number of operations using each label.
+	std::vector<uint32_t> _lowercaseOrder; ///< Labels sorted ignoring case.
+
+	// Trigram postings.
+	std::vector<uint32_t> _grams; ///< Sorted trigrams.
+	std::vector<uint32_t> _gramOffsets; ///< Start of the postings of each trigram, and end of the last one.
+	std::vector<uint32_t> _gramLabels; ///< Labels containing each trigram, sorted.
+
+	// Operations, stored in memory or read from the file when needed.
+	uint64_t _operationCount = 0;
+	std::vector<uint32_t> _labelOperationOffsets; ///< Start of the operations of each label, and end of the last one.
+	std::vector<uint32_t> _labelOperations; ///< Operations using each label, sorted.
+	std::vector<int32_t> _dates; ///< Date key of each operation.
+	std::vector<int64_t> _amounts; ///< Amount of each operation.
+	std::vector<uint32_t> _operationLabels; ///< Label of each operation.
+
+	fs::path _file; ///< File to read operation data from, empty if in memory.
+	mutable std::unique_ptr<fs::ifstream> _stream;
+	uint64_t _labelOperationsStart = 0;
+	uint64_t _datesStart = 0;
+	uint64_t _amountsStart = 0;
+	uint64_t _operationLabelsStart = 0;
+};
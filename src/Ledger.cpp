@@ -0,0 +1,126 @@
+#include "Ledger.hpp"
+#include "Listing.hpp"
+#include "Filter.hpp"
+
+namespace {
+
+	Ledger::Sums toSums(const Totals & totals){
+		Ledger::Sums sums;
+		sums.incomes = totals.first;
+		sums.expenses = totals.second;
+		return sums;
+	}
+
+	thread_local std::string lastErrors;
+
+	/// Collect the warnings and errors logged by the current thread instead of printing them.
+	class Capture {
+	public:
+		Capture(){
+			lastErrors.clear();
+			Log::captureThread(&lastErrors);
+		}
+
+		~Capture(){
+			Log::captureThread(nullptr);
+		}
+	};
+
+	bool parseFilter(const std::string & filter, Filter & compiled){
+		Capture capture;
+		return compiled.parse(filter);
+	}
+}
+
+std::unique_ptr<Ledger> Ledger::load(const std::string & path){
+	Capture capture;
+	if(!System::isFile(path)){
+		Log::Error() << Log::Load << "Unable to find listing at " << path << "." << std::endl;
+		return nullptr;
+	}
+	return std::unique_ptr<Ledger>(new Ledger(std::unique_ptr<Listing>(new Listing(path))));
+}
+
+const std::string & Ledger::lastError(){
+	return lastErrors;
+}
+
+Ledger::Ledger(std::unique_ptr<Listing> && listing) : _listing(std::move(listing)) {
+}
+
+Ledger::~Ledger() = default;
+
+long Ledger::count() const {
+	return _listing->count();
+}
+
+Ledger::Sums Ledger::totals() const {
+	return toSums(_listing->totals());
+}
+
+bool Ledger::totals(const std::string & filter, Sums & sums) const {
+	Filter compiled;
+	if(!parseFilter(filter, compiled)){
+		return false;
+	}
+	sums = toSums(_listing->totals(compiled));
+	return true;
+}
+
+bool Ledger::months(long last, const std::string & filter, std::vector<Month> & months) const {
+	Filter compiled;
+	if(!parseFilter(filter, compiled)){
+		return false;
+	}
+	Date firstMonth;
+	const std::vector<Totals> totals = _listing->monthTotals(last, compiled, firstMonth);
+	const long first = long(firstMonth.year()) * 12 + long(firstMonth.month() - 1);
+	months.clear();
+	months.reserve(totals.size());
+	for(size_t mid = 0; mid < totals.size(); ++mid){
+		Month month;
+		month.year = int((first + long(mid)) / 12);
+		month.month = int((first + long(mid)) % 12) + 1;
+		month.sums = toSums(totals[mid]);
+		months.push_back(month);
+	}
+	return true;
+}
+
+std::vector<Ledger::Entry> Ledger::operations(long first, long count) const {
+	const long begin = std::max(first, 0l);
+	const long end = std::min(begin + std::max(count, 0l), _listing->count());
+	std::vector<Entry> entries;
+	entries.reserve(size_t(std::max(end - begin, 0l)));
+	for(long oid = begin; oid < end; ++oid){
+		entries.push_back(entry(oid));
+	}
+	return entries;
+}
+
+bool Ledger::select(const std::string & filter, long last, std::vector<Entry> & entries) const {
+	Filter compiled;
+	if(!parseFilter(filter, compiled)){
+		return false;
+	}
+	const std::vector<long> ids = _listing->select(compiled, last);
+	entries.clear();
+	entries.reserve(ids.size());
+	for(const long id : ids){
+		entries.push_back(entry(id));
+	}
+	return true;
+}
+
+Ledger::Entry Ledger::entry(long id) const {
+	const Operation & op = _listing->operation(id);
+	Entry entry;
+	entry.index = id;
+	entry.year = op.date().year();
+	entry.month = op.date().month();
+	entry.day = op.date().day();
+	entry.amount = op.amount();
+	entry.label = op.label();
+	entry.category = op.category();
+	return entry;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class Listing;
+
+/**
+ \brief Query a listing from another program linking libdeben, without spawning Deben or parsing its output.
+ Results are plain values, independent of the internal representation, and nothing is printed to the terminal:
+ issues met when loading the listing or parsing a filter are retrieved with lastError().
+ Amounts are in cents, negative for expenses. A ledger can be queried from multiple threads.
+ */
+class Ledger {
+public:
+
+	/// \brief An operation of the listing.
+	struct Entry {
+		long index = 0; ///< Position in the listing, in chronological order.
+		int year = 0;
+		int month = 0; ///< From 1 to 12.
+		int day = 0; ///< From 1 to 31.
+		long long amount = 0;
+		std::string label;
+		std::string category; ///< Assigned by the listing rules, or empty.
+	};
+
+	/// \brief Sums of incomes and expenses.
+	struct Sums {
+		long long incomes = 0;
+		long long expenses = 0; ///< Negative.
+	};
+
+	/// \brief Sums of a calendar month.
+	struct Month {
+		int year = 0;
+		int month = 0; ///< From 1 to 12.
+		Sums sums;
+	};
+
+	/** Load a listing, and its category rules (<path>.rules) if they exist.
+	 \param path the listing file
+	 \return the ledger, or null if the file does not exist
+	 */
+	static std::unique_ptr<Ledger> load(const std::string & path);
+
+	/** \return the warnings and errors of the last load or filter parsing on the current thread, one per line */
+	static const std::string & lastError();
+
+	~Ledger();
+
+	/** \return the number of operations */
+	long count() const;
+
+	/** \return the sums of all operations */
+	Sums totals() const;
+
+	/** Compute the sums of the operations satisfying a filter, using the --filter syntax.
+	 \param filter the filter conditions
+	 \param sums will contain the sums
+	 \return false if the filter is invalid
+	 */
+	bool totals(const std::string & filter, Sums & sums) const;
+
+	/** Compute the sums of each of the last months, up to the current one, or to the month of the most recent operation if later.
+	 \param last the number of months
+	 \param filter optional filter conditions, using the --filter syntax
+	 \param months will contain the months, oldest first
+	 \return false if the filter is invalid
+	 */
+	bool months(long last, const std::string & filter, std::vector<Month> & months) const;
+
+	/** Retrieve a range of operations.
+	 \param first the index of the first operation
+	 \param count the maximum number of operations
+	 \return the operations in the range, in chronological order
+	 */
+	std::vector<Entry> operations(long first, long count) const;
+
+	/** Find the operations satisfying a filter, using the --filter syntax.
+	 \param filter the filter conditions
+	 \param last only keep the last n matching operations, or all if n <= 0
+	 \param entries will contain the operations, in chronological order
+	 \return false if the filter is invalid
+	 */
+	bool select(const std::string & filter, long last, std::vector<Entry> & entries) const;
+
+private:
+
+	explicit Ledger(std::unique_ptr<Listing> && listing);
+
+	/** Convert an operation of the listing.
+	 \param id the operation index
+	 \return the entry
+	 */
+	Entry entry(long id) const;
+
+	std::unique_ptr<Listing> _listing;
+};
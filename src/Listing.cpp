@@ -1,11 +1,154 @@
 #include "Listing.hpp"
 #include "system/TextUtilities.hpp"
 #include "system/System.hpp"
+#include "system/Profiler.hpp"
+
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+	/// FNV-1a hash, can be computed incrementally by passing the previous hash.
+	uint64_t hashBytes(const char * data, size_t size, uint64_t hash = 14695981039346656037ull){
+		for(size_t i = 0; i < size; ++i){
+			hash ^= uint64_t(uchar(data[i]));
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	/// Size and modification time of a file, or default values if it doesn't exist.
+	void fileStamp(const fs::path & path, uintmax_t & size, fs::file_time_type & time){
+		std::error_code ec;
+		size = fs::file_size(path, ec);
+		time = fs::last_write_time(path, ec);
+		if(ec){
+			size = 0;
+			time = fs::file_time_type();
+		}
+	}
+
+}
 
 Listing::Listing(const fs::path & path){
+	Profiler::Scope scope("Load listing");
+	loadRules(path);
+	std::string file;
+	{
+		Profiler::Scope readScope("Read file");
+		// Before reading, so that modifications made meanwhile are detected.
+		fileStamp(path, _sourceFileSize, _sourceTime);
+		file = System::loadStringFromFile(path);
+		readScope.count(0, file.size());
+	}
+	load(file);
+	scope.count(_operations.size());
+}
+
+Listing::Reload Listing::refresh(const fs::path & path){
+	// Operations refer to the categories of the rules, categorize them again if the rules changed.
+	const bool rulesChanged = loadRules(path);
+	if(rulesChanged){
+		for(Operation & ope : _operations){
+			categorize(ope);
+		}
+	}
+
+	// Our own saves are also reported by watchers, skip them without reading the file.
+	uintmax_t fileSize = 0;
+	fs::file_time_type fileTime;
+	fileStamp(path, fileSize, fileTime);
+	if(fileSize == _sourceFileSize && fileTime == _sourceTime){
+		return rulesChanged ? Reload::RULES : Reload::NONE;
+	}
+	std::string file = System::loadStringFromFile(path);
+
+	// Check if the content we previously loaded is still there.
+	const bool samePrefix = file.size() >= _sourceSize && hashBytes(file.data(), _sourceSize) == _sourceHash;
+	if(samePrefix && file.size() == _sourceSize){
+		_sourceFileSize = fileSize;
+		_sourceTime = fileTime;
+		return rulesChanged ? Reload::RULES : Reload::NONE;
+	}
+	// Only parse new lines if they were appended after a complete line.
+	if(samePrefix && _sourceComplete){
+		std::string tail = file.substr(_sourceSize);
+		_sourceHash = hashBytes(tail.data(), tail.size(), _sourceHash);
+		_sourceSize = file.size();
+		_sourceComplete = file.back() == '\n';
+		_sourceFileSize = fileSize;
+		_sourceTime = fileTime;
+		parse(tail);
+		return Reload::APPEND;
+	}
+	// Keep the previous content state, so that saving detects the conflict.
+	if(_modified){
+		Log::Warning() << "Listing at " << path << " was modified by another program, changes made since loading it won't be saved." << std::endl;
+		return rulesChanged ? Reload::RULES : Reload::NONE;
+	}
+	_sourceFileSize = fileSize;
+	_sourceTime = fileTime;
+	reload(file);
+	return Reload::FULL;
+}
+
+void Listing::revert(const fs::path & path){
+	fileStamp(path, _sourceFileSize, _sourceTime);
 	std::string file = System::loadStringFromFile(path);
-	TextUtilities::replace( file, "\r\n", "\n" );
-	const auto lines = TextUtilities::split(file, "\n", true);
+	reload(file);
+	_modified = false;
+}
+
+void Listing::reload(std::string & content){
+	_operations.clear();
+	_comments.clear();
+	_totals = {Amount(0), Amount(0)};
+	load(content);
+}
+
+void Listing::load(std::string & content){
+	_sourceSize = content.size();
+	_sourceHash = hashBytes(content.data(), content.size());
+	_sourceComplete = content.empty() || content.back() == '\n';
+	parse(content);
+}
+
+bool Listing::loadRules(const fs::path & path){
+	fs::path rulesPath = path;
+	rulesPath += ".rules";
+	std::error_code ec;
+	uintmax_t size = 0;
+	fs::file_time_type time;
+	if(System::isFile(rulesPath)){
+		size = fs::file_size(rulesPath, ec);
+		time = fs::last_write_time(rulesPath, ec);
+		if(ec){
+			size = 0;
+			time = fs::file_time_type();
+		}
+	}
+	// A missing file keeps the default size and time.
+	if(size == _rulesSize && time == _rulesTime){
+		return false;
+	}
+	_rulesSize = size;
+	_rulesTime = time;
+	_categorizer.reset();
+	if(System::isFile(rulesPath)){
+		_categorizer.reset(new Categorizer());
+		if(!_categorizer->load(rulesPath)){
+			_categorizer.reset();
+		}
+	}
+	return true;
+}
+
+void Listing::parse(std::string & content){
+	Profiler::Scope scope("Parse");
+	scope.count(0, content.size());
+	TextUtilities::replace( content, "\r\n", "\n" );
+	const auto lines = TextUtilities::split(content, "\n", true);
+	std::vector<Operation> operations;
 
 	for(const auto & lineRaw : lines){
 		const std::string line = TextUtilities::trim(lineRaw, "\t ");
@@ -20,31 +163,109 @@ Listing::Listing(const fs::path & path){
 		if( toks.empty() ) {
 			continue;
 		}
-		_operations.emplace_back( toks );
+		operations.emplace_back( toks );
 	}
+
+	// Update totals once, they will then be updated incrementally.
+	for(auto & ope : operations){
+		categorize(ope);
+		if(ope.type() == Operation::Type::In){
+			_totals.first += ope.amount();
+		} else {
+			_totals.second += ope.amount();
+		}
+	}
+	// Files edited by hand might not be sorted.
+	scope.count(operations.size());
+	insertSorted(operations);
+	_labelIndex.reset();
+	_duplicateIndex.reset();
 }
 
-void Listing::save(const fs::path & path){
-	if(!_modified){
+void Listing::insertSorted(std::vector<Operation> & operations){
+	if(operations.empty()){
 		return;
 	}
-	
-	// Start by stringifying the operations and sorting them.
-	std::vector<std::string> lines(_operations.size());
-	for(size_t oid = 0; oid < _operations.size(); ++oid){
-		lines[oid] = _operations[oid].toString();
+	const auto byDate = [](const Operation & a, const Operation & b){
+		return a.date() < b.date();
+	};
+	std::stable_sort(operations.begin(), operations.end(), byDate);
+
+	// Common case: all new operations are more recent.
+	if(_operations.empty() || !byDate(operations.front(), _operations.back())){
+		_operations.reserve(_operations.size() + operations.size());
+		std::move(operations.begin(), operations.end(), std::back_inserter(_operations));
+		operations.clear();
+		return;
 	}
-	std::sort(lines.begin(), lines.end());
 
-	// Merge all content.
+	// Merge in one pass, existing operations first when on the same day.
+	std::vector<Operation> merged;
+	merged.reserve(_operations.size() + operations.size());
+	auto existing = _operations.begin();
+	auto added = operations.begin();
+	while(existing != _operations.end() && added != operations.end()){
+		if(byDate(*added, *existing)){
+			merged.push_back(std::move(*added));
+			++added;
+		} else {
+			merged.push_back(std::move(*existing));
+			++existing;
+		}
+	}
+	std::move(existing, _operations.end(), std::back_inserter(merged));
+	std::move(added, operations.end(), std::back_inserter(merged));
+	_operations.swap(merged);
+	operations.clear();
+}
+
+void Listing::categorize(Operation & operation) const {
+	operation.setCategory(_categorizer ? _categorizer->classify(operation.label()) : nullptr);
+}
+
+bool Listing::sourceUnchanged(const fs::path & path) const {
+	uintmax_t fileSize = 0;
+	fs::file_time_type fileTime;
+	fileStamp(path, fileSize, fileTime);
+	if(fileSize == _sourceFileSize && fileTime == _sourceTime){
+		return true;
+	}
+	const std::string file = System::loadStringFromFile(path);
+	return file.size() == _sourceSize && hashBytes(file.data(), file.size()) == _sourceHash;
+}
+
+bool Listing::save(const fs::path & path){
+	if(!_modified){
+		return true;
+	}
+	// Don't overwrite the modifications of another program.
+	if(!sourceUnchanged(path)){
+		Log::Error() << "Listing at " << path << " was modified by another program, changes were not saved." << std::endl;
+		return false;
+	}
+	Profiler::Scope scope("Save");
+	
+	// Operations are kept sorted, write them in order after the comments.
 	std::string content;
 	for(const auto & line : _comments){
 		content.append(line + "\n");
 	}
-	for(const auto & line : lines){
-		content.append(line + "\n");
+	for(const auto & ope : _operations){
+		content.append(ope.toString() + "\n");
 	}
-	System::writeStringToFile(content, path);
+	if(!System::writeStringToFile(content, path)){
+		return false;
+	}
+	scope.count(_operations.size(), content.size());
+	_modified = false;
+
+	// Keep track of the file content, including the final line ending.
+	_sourceHash = hashBytes(content.data(), content.size());
+	_sourceHash = hashBytes("\n", 1, _sourceHash);
+	_sourceSize = content.size() + 1;
+	_sourceComplete = true;
+	fileStamp(path, _sourceFileSize, _sourceTime);
+	return true;
 }
 
 void Listing::removeOperation(long id){
@@ -56,8 +277,16 @@ void Listing::removeOperation(long id){
 		Log::Warning() << "Operation " << id << " doesn't exist." << std::endl;
 		return;
 	}
+	const Operation & ope = _operations[id];
+	if(ope.type() == Operation::Type::In){
+		_totals.first -= ope.amount();
+	} else {
+		_totals.second -= ope.amount();
+	}
 	_operations.erase(_operations.begin() + id);
 	_modified = true;
+	_labelIndex.reset();
+	_duplicateIndex.reset();
 }
 
 void Listing::addOperation(const std::vector<std::string> & args){
@@ -65,40 +294,48 @@ void Listing::addOperation(const std::vector<std::string> & args){
 		Log::Warning() << "No operation to add." << std::endl;
 		return;
 	}
-	_modified = true;
-
-	// Get amount.
-	const Amount amount = Operation::parseAmount(args[0]);
-
-	// Extract date if present.
-	Date date;
-	size_t lastLabelToken = args.size()-1;
+	addOperation(Operation::fromArguments(args));
+}
 
-	if(args.size() > 2){
-		// Check if last argument is a valid date.
-		const std::string & dateStr = args[args.size()-1];
-		const std::string::size_type pos = dateStr.find_first_not_of("0123456789/");
-		if(pos == std::string::npos){
-			date = Date::dateFromTokens(dateStr);
-			--lastLabelToken;
-		}
+void Listing::addOperation(const Operation & operation){
+	_modified = true;
+	// Insert after all operations of the same day or before.
+	const auto pos = std::upper_bound(_operations.begin(), _operations.end(), operation, [](const Operation & a, const Operation & b){
+		return a.date() < b.date();
+	});
+	categorize(*_operations.insert(pos, operation));
+	_labelIndex.reset();
+	if(_duplicateIndex){
+		_duplicateIndex->insert(operation);
+	}
+	if(operation.type() == Operation::Type::In){
+		_totals.first += operation.amount();
+	} else {
+		_totals.second += operation.amount();
 	}
+}
 
-	// Remaining tokens are the label, merge them.
-	std::string label;
-	for(size_t lid = 1; lid <= lastLabelToken; ++lid){
-		if(lid != 1){
-			label.append(" ");
-		}
-		label.append(args[lid]);
+void Listing::addOperations(std::vector<Operation> & operations){
+	if(operations.empty()){
+		return;
 	}
-	if(label.empty()){
-		label = "Unknown";
+	_modified = true;
+	for(Operation & ope : operations){
+		categorize(ope);
+		if(_duplicateIndex){
+			_duplicateIndex->insert(ope);
+		}
+		if(ope.type() == Operation::Type::In){
+			_totals.first += ope.amount();
+		} else {
+			_totals.second += ope.amount();
+		}
 	}
-	_operations.emplace_back(amount, label, date);
+	insertSorted(operations);
+	_labelIndex.reset();
 }
 
-std::vector<Operation> Listing::operations(long last){
+std::vector<Operation> Listing::operations(long last) const {
 	if(last <= 0){
 		return _operations;
 	}
@@ -114,7 +351,89 @@ std::vector<Operation> Listing::operations(long last){
 }
 
 
-std::vector<Totals> Listing::monthTotals(long last){
+std::vector<long> Listing::select(const Filter & filter, long last) const {
+	Profiler::Scope scope("Filter");
+	const auto range = dateRange(filter.minDate(), filter.maxDate());
+	scope.count(size_t(range.second - range.first));
+	std::vector<long> indices;
+	if(last <= 0){
+		for(long oid = range.first; oid < range.second; ++oid){
+			if(filter.matches(_operations[oid])){
+				indices.push_back(oid);
+			}
+		}
+		return indices;
+	}
+	// Start from the most recent operations.
+	for(long oid = range.second - 1; oid >= range.first && long(indices.size()) < last; --oid){
+		if(filter.matches(_operations[oid])){
+			indices.push_back(oid);
+		}
+	}
+	std::reverse(indices.begin(), indices.end());
+	return indices;
+}
+
+std::vector<long> Listing::top(long n, Operation::Type type, const Filter & filter) const {
+	if(n <= 0){
+		return {};
+	}
+	// Magnitude of an operation, negative for operations of the other type so that they are never kept.
+	const auto magnitude = [this, type](long oid){
+		const Amount amount = _operations[oid].amount();
+		return type == Operation::Type::In ? amount : -amount;
+	};
+	// Min-heap of the largest operations found so far, the earliest one wins ties.
+	const auto larger = [&magnitude](long a, long b){
+		const Amount ma = magnitude(a);
+		const Amount mb = magnitude(b);
+		return ma != mb ? ma > mb : a < b;
+	};
+	std::vector<long> heap;
+	heap.reserve(size_t(n));
+
+	const auto range = dateRange(filter.minDate(), filter.maxDate());
+	for(long oid = range.first; oid < range.second; ++oid){
+		const Operation & ope = _operations[oid];
+		if(ope.type() != type || ope.amount() == 0){
+			continue;
+		}
+		// Only test the filter on operations that would enter the heap.
+		if(long(heap.size()) == n && !larger(oid, heap.front())){
+			continue;
+		}
+		if(!filter.matches(ope)){
+			continue;
+		}
+		if(long(heap.size()) == n){
+			std::pop_heap(heap.begin(), heap.end(), larger);
+			heap.back() = oid;
+		} else {
+			heap.push_back(oid);
+		}
+		std::push_heap(heap.begin(), heap.end(), larger);
+	}
+	std::sort(heap.begin(), heap.end());
+	return heap;
+}
+
+std::pair<long, long> Listing::dateRange(int minDate, int maxDate) const {
+	const auto begin = std::partition_point(_operations.begin(), _operations.end(), [minDate](const Operation & op){
+		return op.date().key() < minDate;
+	});
+	const auto end = std::partition_point(begin, _operations.end(), [maxDate](const Operation & op){
+		return op.date().key() <= maxDate;
+	});
+	return {long(begin - _operations.begin()), long(end - _operations.begin())};
+}
+
+std::vector<Totals> Listing::monthTotals(long last, const Filter & filter) const {
+	Date firstMonth;
+	return monthTotals(last, filter, firstMonth);
+}
+
+std::vector<Totals> Listing::monthTotals(long last, const Filter & filter, Date & firstMonth) const {
+	Profiler::Scope scope("Month totals");
 	// We need unique comparison of months.
 	const auto hashDate = [](const Date & date){
 		return long(date.year()) * 12 + long(date.month());
@@ -123,17 +442,23 @@ std::vector<Totals> Listing::monthTotals(long last){
 	// Get current month.
 	const Date now;
 	const long currentMonth = hashDate(now);
-	const long earliestMonth = std::max(currentMonth - last + 1, long(0));
-	// We need to find the earliest record from this month.
-	const auto firstOp = std::find_if(_operations.begin(), _operations.end(), [earliestMonth, &hashDate](const Operation & op){
-		return hashDate(op.date()) >= earliestMonth;
+	const long earliestMonth = std::max(currentMonth - last + 1, long(1));
+	firstMonth = Date(int((earliestMonth - 1) / 12), int((earliestMonth - 1) % 12) + 1, 1);
+	// We need to find the earliest record from this month, operations are sorted.
+	const auto firstOp = std::partition_point(_operations.begin(), _operations.end(), [earliestMonth, &hashDate](const Operation & op){
+		return hashDate(op.date()) < earliestMonth;
 	});
 
 	std::vector<Totals> totals = { {Amount(0), Amount(0)}};
 
 	long ongoingMonth = earliestMonth;
 
-	for(auto op = firstOp; op != _operations.end(); ++op ){
+	const auto lastOp = _operations.begin() + dateRange(filter.minDate(), filter.maxDate()).second;
+	const bool filtered = !filter.empty();
+	for(auto op = firstOp; op < lastOp; ++op ){
+		if(filtered && !filter.matches(*op)){
+			continue;
+		}
 		const long opMonth = hashDate(op->date());
 		if(opMonth != ongoingMonth){
 			for(long mid = ongoingMonth + 1; mid <= opMonth; ++mid){
@@ -149,6 +474,7 @@ std::vector<Totals> Listing::monthTotals(long last){
 			tots.second += op->amount();
 		}
 	}
+	scope.count(size_t(lastOp > firstOp ? lastOp - firstOp : 0));
 	// Handle missing months after last record.
 	for(long mid = ongoingMonth + 1; mid <= currentMonth; ++mid){
 		totals.emplace_back(Amount(0), Amount(0));
@@ -157,9 +483,23 @@ std::vector<Totals> Listing::monthTotals(long last){
 	return totals;
 }
 
-Totals Listing::totals(){
+Totals Listing::totals() const {
+	return _totals;
+}
+
+Totals Listing::totals(const Filter & filter) const {
+	if(filter.empty()){
+		return _totals;
+	}
+	Profiler::Scope scope("Filtered totals");
 	Totals totals = {Amount(0), Amount(0)};
-	for(const auto & ope : _operations){
+	const auto range = dateRange(filter.minDate(), filter.maxDate());
+	scope.count(size_t(range.second - range.first));
+	for(long oid = range.first; oid < range.second; ++oid){
+		const Operation & ope = _operations[oid];
+		if(!filter.matches(ope)){
+			continue;
+		}
 		if(ope.type() == Operation::Type::In){
 			totals.first += ope.amount();
 		} else {
@@ -169,7 +509,72 @@ Totals Listing::totals(){
 	return totals;
 }
 
+const Operation & Listing::operation(long id) const {
+	return _operations[id];
+}
+
 long Listing::count() const {
 	return long(_operations.size());
 }
 
+const LabelIndex & Listing::labelIndex() const {
+	std::lock_guard<std::mutex> lock(_labelIndexMutex);
+	if(!_labelIndex){
+		Profiler::Scope scope("Build label index");
+		scope.count(_operations.size());
+		_labelIndex.reset(new LabelIndex(*this));
+	}
+	return *_labelIndex;
+}
+
+bool Listing::containsDuplicate(const Operation & operation, int window) const {
+	std::lock_guard<std::mutex> lock(_duplicateIndexMutex);
+	if(!_duplicateIndex || _duplicateIndex->window() != std::max(window, 0)){
+		Profiler::Scope scope("Build duplicate index");
+		scope.count(_operations.size());
+		_duplicateIndex.reset(new DuplicateIndex(*this, window));
+	}
+	return _duplicateIndex->contains(operation);
+}
+
+
+Totals Listing::streamTotals(const fs::path & path){
+	Profiler::Scope scope("Stream totals");
+	Totals totals = {Amount(0), Amount(0)};
+
+	System::forEachLine(path, [&totals, &scope](const char * line, size_t size){
+		scope.count(1, size + 1);
+		const char * end = line + size;
+		// Skip leading spaces, empty and comment lines.
+		while(line != end && (*line == ' ' || *line == '\t')){
+			++line;
+		}
+		if(line == end || *line == '#'){
+			return;
+		}
+		// The amount is the second non-empty field.
+		const char * dateEnd = static_cast<const char *>(std::memchr(line, '\t', size_t(end - line)));
+		if(dateEnd == nullptr){
+			return;
+		}
+		const char * amountBegin = dateEnd;
+		while(amountBegin != end && *amountBegin == '\t'){
+			++amountBegin;
+		}
+		if(amountBegin == end){
+			return;
+		}
+		const char * amountEnd = static_cast<const char *>(std::memchr(amountBegin, '\t', size_t(end - amountBegin)));
+		if(amountEnd == nullptr){
+			amountEnd = end;
+		}
+
+		const Amount amount = Operation::parseAmount(amountBegin, size_t(amountEnd - amountBegin));
+		if(amount > Amount(0)){
+			totals.first += amount;
+		} else {
+			totals.second += amount;
+		}
+	});
+	return totals;
+}
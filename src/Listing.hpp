@@ -2,31 +2,157 @@
 
 #include "Common.hpp"
 #include "Operation.hpp"
+#include "Filter.hpp"
+#include "Categorizer.hpp"
+#include "LabelIndex.hpp"
+#include "DuplicateIndex.hpp"
 #include "system/System.hpp"
 
+#include <cstdint>
+#include <mutex>
+
 class Listing {
 public:
 
+	/// Result of a listing refresh.
+	enum class Reload {
+		NONE, ///< The file is unchanged.
+		APPEND, ///< New lines were appended and parsed.
+		FULL, ///< The file was modified and fully reloaded.
+		RULES ///< Only the category rules were modified, operations were categorized again.
+	};
+
+	/** Load a listing, and the category rules stored next to it (<path>.rules) if they exist.
+	 \param path the listing file
+	 */
 	Listing(const fs::path & path);
 
-	void save(const fs::path & path);
+	/** Update the listing after its file or its category rules have been modified by another program.
+	 The file is only read if its size or modification time changed, and only appended lines are parsed
+	 if the previously loaded content is unchanged. Unsaved modifications are kept, but can't be saved anymore
+	 if the content was modified otherwise.
+	 \param path the listing file
+	 \return how the listing was updated
+	 */
+	Reload refresh(const fs::path & path);
+
+	/** Discard unsaved modifications and load the listing file again.
+	 \param path the listing file
+	 */
+	void revert(const fs::path & path);
+
+	/** Write the listing if it was modified, unless another program modified the file since it was loaded.
+	 \param path the listing file
+	 \return true if the file is up to date
+	 */
+	bool save(const fs::path & path);
 
 	void removeOperation(long id);
 
 	void addOperation(const std::vector<std::string> & args);
 
-	std::vector<Operation> operations(long last);
+	void addOperation(const Operation & operation);
+
+	/** Insert many operations at once, in O(n + k log k) for k new operations.
+	 The new operations are sorted by date and merged with the existing ones in a single pass,
+	 new operations are placed after existing ones from the same day.
+	 \param operations the operations to insert, will be emptied
+	 */
+	void addOperations(std::vector<Operation> & operations);
+
+	std::vector<Operation> operations(long last) const;
 
-	std::vector<Totals> monthTotals(long last);
+	/** Find the operations kept by a filter. Only operations in the filter date range are tested.
+	 \param filter the filter to apply
+	 \param last only keep the last n matching operations, or all if n <= 0
+	 \return the indices of the matching operations, in chronological order
+	 */
+	std::vector<long> select(const Filter & filter, long last = 0) const;
 
-	Totals totals();
+	/** Find the largest incomes or expenses among the operations kept by a filter, using a bounded heap.
+	 \param n the number of operations to find
+	 \param type the kind of operations to rank
+	 \param filter the filter to apply
+	 \return the indices of the largest operations, in chronological order
+	 */
+	std::vector<long> top(long n, Operation::Type type, const Filter & filter) const;
+
+	std::vector<Totals> monthTotals(long last, const Filter & filter = Filter()) const;
+
+	/** Compute the totals of each month, from the last n months up to the current one, or to the month of the most recent operation if later.
+	 \param last the number of months before the current one, included
+	 \param filter the filter to apply
+	 \param firstMonth will contain the first day of the first month
+	 \return the totals of each month, oldest first
+	 */
+	std::vector<Totals> monthTotals(long last, const Filter & filter, Date & firstMonth) const;
+
+	Totals totals() const;
+
+	Totals totals(const Filter & filter) const;
+
+	const Operation & operation(long id) const;
 
 	long count() const;
 
+	/** Retrieve the index of labels, built on first use and kept until the listing is modified.
+	 \return the label index
+	 */
+	const LabelIndex & labelIndex() const;
+
+	/** Check if an operation is a duplicate of one in the listing, with the same amount and label and a close date.
+	 The index of duplicates is built on first use, updated when operations are added, and dropped when others are removed.
+	 \param operation the operation to look for
+	 \param window maximum number of days between two duplicates
+	 \return true if a duplicate was found
+	 */
+	bool containsDuplicate(const Operation & operation, int window) const;
+
+	static Totals streamTotals(const fs::path & path);
+
 private:
 
-	std::vector<Operation> _operations;
+	void load(std::string & content);
+
+	/** Load the category rules stored next to a listing, if they were modified since the last load.
+	 \param path the listing file
+	 \return true if the rules were modified
+	 */
+	bool loadRules(const fs::path & path);
+
+	/** Replace all operations by the ones of a file content.
+	 \param content the listing file content
+	 */
+	void reload(std::string & content);
+
+	/** \return true if the listing file still contains the content that was loaded or saved */
+	bool sourceUnchanged(const fs::path & path) const;
+
+	void parse(std::string & content);
+
+	void insertSorted(std::vector<Operation> & operations);
+
+	std::pair<long, long> dateRange(int minDate, int maxDate) const;
+
+	void categorize(Operation & operation) const;
+
+	std::vector<Operation> _operations; ///< Sorted by date.
 	std::vector<std::string> _comments;
+	std::unique_ptr<Categorizer> _categorizer; ///< Category rules, if any.
+	uintmax_t _rulesSize = 0; ///< Size of the loaded rules file, to detect changes.
+	fs::file_time_type _rulesTime; ///< Modification time of the loaded rules file.
+	mutable std::unique_ptr<LabelIndex> _labelIndex; ///< Built on demand.
+	mutable std::mutex _labelIndexMutex;
+	mutable std::unique_ptr<DuplicateIndex> _duplicateIndex; ///< Built on demand.
+	mutable std::mutex _duplicateIndexMutex;
+	Totals _totals = {Amount(0), Amount(0)};
 	bool _modified = false;
+
+	// Loaded file state, to detect appends.
+	size_t _sourceSize = 0;
+	uint64_t _sourceHash = 0;
+	bool _sourceComplete = true;
+	uintmax_t _sourceFileSize = 0; ///< Size of the file when its content was loaded or saved.
+	fs::file_time_type _sourceTime; ///< Modification time of the file when its content was loaded or saved.
 	
 };
@@ -4,6 +4,8 @@
 #include "Printer.hpp"
 #include "system/TextUtilities.hpp"
 
+#include <cctype>
+
 Operation::Operation(Amount amount, const std::string & label, const Date & date):
 	_date(date), _label(label), _amount(amount), _type(amount > Amount(0) ? In : Out){
 
@@ -27,8 +29,40 @@ Operation::Operation(const std::vector<std::string> & strs){
 
 }
 
+Operation Operation::fromArguments(const std::vector<std::string> & args){
+	// Get amount.
+	const Amount amount = Operation::parseAmount(args[0]);
+
+	// Extract date if present.
+	Date date;
+	size_t lastLabelToken = args.size()-1;
+
+	if(args.size() > 2){
+		// Check if last argument is a valid date.
+		const std::string & dateStr = args[args.size()-1];
+		const std::string::size_type pos = dateStr.find_first_not_of("0123456789/");
+		if(pos == std::string::npos){
+			date = Date::dateFromTokens(dateStr);
+			--lastLabelToken;
+		}
+	}
+
+	// Remaining tokens are the label, merge them.
+	std::string label;
+	for(size_t lid = 1; lid <= lastLabelToken; ++lid){
+		if(lid != 1){
+			label.append(" ");
+		}
+		label.append(args[lid]);
+	}
+	if(label.empty()){
+		label = "Unknown";
+	}
+	return Operation(amount, label, date);
+}
+
 std::string Operation::toString() const {
-	const std::string dateStr = _date.toString("%Y/%m/%d");
+	const std::string dateStr = _date.toString(Date::Format::YearMonthDay);
 	const std::string signStr = (_type == Type::In ? "+" : "-");
 	const std::string amountStr = Operation::writeAmount(std::abs(_amount), false);
 	return dateStr + "\t" + signStr + amountStr + "\t" + _label;
@@ -50,41 +84,134 @@ const Date & Operation::date() const {
 	return _date;
 }
 
+const std::string & Operation::category() const {
+	static const std::string none;
+	return _category ? *_category : none;
+}
+
+void Operation::setCategory(const std::string * category){
+	_category = category;
+}
+
+namespace {
+
+	/// Parse the absolute value of an integer, stopping at the first non-digit character.
+	long long parseInteger(const char * begin, const char * end){
+		while(begin != end && std::isspace(uchar(*begin))){
+			++begin;
+		}
+		if(begin != end && (*begin == '+' || *begin == '-')){
+			++begin;
+		}
+		long long value = 0;
+		for(; begin != end && *begin >= '0' && *begin <= '9'; ++begin){
+			value = value * 10 + (*begin - '0');
+		}
+		return value;
+	}
+
+}
+
 Amount Operation::parseAmount(const std::string & s){
-	const std::string ns = TextUtilities::trim(s, "\t ");
-	if(ns.empty()){
+	return parseAmount(s.data(), s.size());
+}
+
+Amount Operation::parseAmount(const char * str, size_t size){
+	// Trim spaces and tabulations.
+	const char * begin = str;
+	const char * end = str + size;
+	while(begin != end && (*begin == ' ' || *begin == '\t')){
+		++begin;
+	}
+	while(end != begin && (*(end-1) == ' ' || *(end-1) == '\t')){
+		--end;
+	}
+	if(begin == end){
 		return 0;
 	}
 
 	// We store in fixed point (+-)61.2 with the extra convention
 	// that positive numbers have a mandatory + prefix sign.
-	const long long sgn = ns[0] == '+' ? 1 : -1;
+	const long long sgn = *begin == '+' ? 1 : -1;
 
 	// Find decimal point.
-	const auto pos = ns.find_last_of(".,");
+	const char * pos = end;
+	for(const char * c = end; c != begin; --c){
+		if(*(c-1) == '.' || *(c-1) == ','){
+			pos = c-1;
+			break;
+		}
+	}
 
-	const std::string stru = ns.substr(0, pos);
-	const long long unts = stru.empty() ? 0 : std::abs(std::stoll(stru));
+	const long long unts = parseInteger(begin, pos);
 
 	// If no decimal digits, integer * 100.
-	if(pos == std::string::npos || pos == (ns.size()-1)){
+	if(pos == end || pos == (end-1)){
 		return sgn * unts * 100;
 	}
 	// Else get the first two decimals.
-	const std::string strd = ns.substr(pos+1);
+	const char * decBegin = pos + 1;
 	long long decs = 0;
-	if(strd.size() == 1){
+	if(end - decBegin == 1){
 		// We only have a tenth digit.
-		decs = 10 * std::abs(std::stoll(strd));
-	} else if(strd.size() > 1){
+		decs = 10 * parseInteger(decBegin, end);
+	} else {
 		// We only want the highest two digits.
-		const std::string strd2 = strd.substr(0, 2);
-		decs = std::abs(std::stoll(strd2));
+		decs = parseInteger(decBegin, decBegin + 2);
 	}
 
 	return sgn * (unts * 100 + decs);
 }
 
+bool Operation::parseSignedAmount(const std::string & s, Amount & amount){
+	// Keep digits and separators only, ignoring spaces and apostrophes used for grouping.
+	std::string digits;
+	bool negative = false;
+	bool parenthesis = false;
+	for(const char c : s){
+		if((c >= '0' && c <= '9') || c == '.' || c == ','){
+			digits += c;
+		} else if(c == '-' || (c == '(' && digits.empty())){
+			negative = true;
+			parenthesis = parenthesis || c == '(';
+		} else if(c == '+' || c == ' ' || c == '\t' || c == '\'' || (c == ')' && parenthesis)){
+			continue;
+		} else if((uchar(c) & 0x80) != 0){
+			// Non-breaking spaces and currency symbols.
+			continue;
+		} else {
+			return false;
+		}
+	}
+	if(digits.find_first_of("0123456789") == std::string::npos){
+		return false;
+	}
+
+	// The last separator is a decimal one if followed by one or two digits.
+	long long unts = 0;
+	long long decs = 0;
+	const std::string::size_type pos = digits.find_last_of(".,");
+	const size_t decCount = pos == std::string::npos ? 0 : digits.size() - pos - 1;
+	const bool hasDecimals = decCount == 1 || decCount == 2;
+	const std::string::size_type unitsEnd = hasDecimals ? pos : digits.size();
+	for(std::string::size_type i = 0; i < unitsEnd; ++i){
+		if(digits[i] >= '0' && digits[i] <= '9'){
+			unts = unts * 10 + (digits[i] - '0');
+		}
+	}
+	if(hasDecimals){
+		for(size_t i = pos + 1; i < digits.size(); ++i){
+			if(digits[i] < '0' || digits[i] > '9'){
+				return false;
+			}
+			decs = decs * 10 + (digits[i] - '0');
+		}
+		decs *= decCount == 1 ? 10 : 1;
+	}
+	amount = (negative ? -1 : 1) * (unts * 100 + decs);
+	return true;
+}
+
 std::string Operation::writeAmount(const Amount & a, bool showPlusSign){
 	// We store in fixed point (+-)61.2
 	const long long unts = std::abs(a) / 100;
@@ -101,6 +228,13 @@ std::string Operation::writeAmount(const Amount & a, bool showPlusSign){
 }
 
 size_t Operation::amountLength(const Amount & a){
-	return size_t(std::ceil(std::log10(a))+1 + (a < 0 ? 1: 0));
+	// Count digits of the units, plus the sign, decimal point and two decimals.
+	Amount unts = std::abs(a) / 100;
+	size_t length = (a < 0 ? 1 : 0) + 4;
+	while(unts >= 10){
+		unts /= 10;
+		++length;
+	}
+	return length;
 }
 
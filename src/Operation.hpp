@@ -16,6 +16,12 @@ public:
 	Operation(Amount amount, const std::string & label, const Date & date);
 
 	Operation(const std::vector<std::string> & strs);
+
+	/** Create an operation from command line arguments: amount, label tokens and an optional partial date.
+	 \param args the arguments, at least an amount
+	 \return the operation
+	 */
+	static Operation fromArguments(const std::vector<std::string> & args);
 	
 	const std::string & label() const;
 
@@ -27,8 +33,26 @@ public:
 
 	const Date & date() const;
 
+	/** \return the category assigned by the listing rules, or an empty string */
+	const std::string & category() const;
+
+	/** Assign a category to the operation.
+	 \param category the category name, owned by the rules, or null
+	 */
+	void setCategory(const std::string * category);
+
 	static Amount parseAmount(const std::string & s);
 
+	static Amount parseAmount(const char * str, size_t size);
+
+	/** Parse an amount written by a bank or a user, where unsigned amounts are positive.
+	 Spaces and grouping separators are ignored, the decimal separator can be a point or a comma.
+	 \param s the string to parse
+	 \param amount will contain the parsed amount
+	 \return false if the string is not a valid amount
+	 */
+	static bool parseSignedAmount(const std::string & s, Amount & amount);
+
 	static std::string writeAmount(const Amount & a, bool showPlusSign = false);
 
 	static size_t amountLength(const Amount & a);
@@ -38,4 +62,5 @@ private:
 	std::string _label;
 	Amount _amount;
 	Type _type;
+	const std::string * _category = nullptr;
 };
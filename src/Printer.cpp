@@ -1,6 +1,29 @@
 #include "Printer.hpp"
 #include "system/TextUtilities.hpp"
 #include "system/Terminal.hpp"
+#include "system/Profiler.hpp"
+
+#include <cstdlib>
+
+namespace {
+
+	/// Number of operations used to compute the width of list columns.
+	const size_t listLookahead = 4096;
+
+	/// Size of the blocks of rendered list sent to the terminal.
+	const size_t listBlockSize = 1 << 16;
+
+	/// Shorten a label to a number of characters, ending with an ellipsis.
+	std::string shortenLabel(const std::string & label, size_t length){
+		const size_t kept = length > 3 ? length - 3 : 0;
+		size_t pos = 0;
+		for(size_t cid = 0; cid < kept && pos < label.size(); ++cid){
+			const int size = std::mblen(&label[pos], label.size() - pos);
+			pos += size_t(std::max(size, 1));
+		}
+		return label.substr(0, pos) + std::string(std::min(length, size_t(3)), '.');
+	}
+}
 
 void Printer::printTotals(const Totals & totals, bool leadingNewline){
 	std::string tPos = Operation::writeAmount(totals.first);
@@ -31,17 +54,47 @@ void Printer::printTotals(const Totals & totals, bool leadingNewline){
 }
 
 void Printer::printList(const std::vector<Operation> & operations, long totalCount){
-	if(operations.empty()) {
+	// The operations are the last ones of the listing.
+	std::vector<long> indices(operations.size());
+	for(size_t oid = 0; oid < operations.size(); ++oid){
+		indices[oid] = totalCount - long(operations.size()) + long(oid);
+	}
+	printList(operations, indices, totalCount);
+}
+
+void Printer::printList(const std::vector<Operation> & operations, const std::vector<long> & indices, long totalCount){
+	printOperations(operations.size(), [&operations](size_t oid) -> const Operation & {
+		return operations[oid];
+	}, [&indices](size_t oid){
+		return indices[oid];
+	}, totalCount);
+}
+
+void Printer::printList(const Listing & list, long first, long end){
+	first = std::max(first, 0l);
+	end = std::max(std::min(end, list.count()), first);
+	printOperations(size_t(end - first), [&list, first](size_t oid) -> const Operation & {
+		return list.operation(first + long(oid));
+	}, [first](size_t oid){
+		return first + long(oid);
+	}, list.count());
+}
+
+void Printer::printOperations(size_t count, const std::function<const Operation & (size_t)> & operation, const std::function<long(size_t)> & index, long totalCount){
+	Profiler::Scope scope("Render list");
+	scope.count(count);
+	if(count == 0) {
 		Terminal::outputUnicode(Terminal::italic( "Empty list" ) + "\n");
 		return;
 	}
 
-	// Compute various needed lengths.
+	// Compute various needed lengths, on a bounded number of operations.
 	const std::string tCountStr = std::to_string(totalCount);
 	const int maxIndexSize = int(tCountStr.size());
 	int maxDescSize = 0;
-	for(const auto & op : operations){
-		maxDescSize = std::max(maxDescSize, int(TextUtilities::count(op.label())));
+	const size_t lookahead = std::min(count, listLookahead);
+	for(size_t oid = 0; oid < lookahead; ++oid){
+		maxDescSize = std::max(maxDescSize, int(TextUtilities::count(operation(oid).label())));
 	}
 	const int maxLineSize = maxIndexSize + 27 + maxDescSize;
 
@@ -57,26 +110,30 @@ void Printer::printList(const std::vector<Operation> & operations, long totalCou
 
 	// Initial list header.
 	std::string fullStr = "\n ";
-	fullStr += Terminal::inverse("Operations: " + std::to_string(operations.size()) + "/" + tCountStr + " entries.");
+	fullStr += Terminal::inverse("Operations: " + std::to_string(count) + "/" + tCountStr + " entries.");
 
 	// Initial values for months header and footers.
-	const Date & initDate = operations[0].date();
+	const Date & initDate = operation(0).date();
 	int currentMonth = initDate.month();
+	int currentYear = initDate.year();
 	Totals localTotals = {Amount(0), Amount(0)};
 
 	// First month header.
 	fullStr += "\n" + extSep + "\n" + monthHeader(initDate, maxIndexSize, maxLineSize, verSep, intSep);
+	// Output the beginning of the list without waiting.
+	Terminal::outputUnicode(fullStr);
+	fullStr.clear();
 
-
-	long i = totalCount - long(operations.size());
-	for(const auto & op : operations) {
+	for(size_t oid = 0; oid < count; ++oid) {
+		const Operation & op = operation(oid);
 		// If new month, insert a footer then a header.
-		if(op.date().month() != currentMonth){
+		if(op.date().month() != currentMonth || op.date().year() != currentYear){
 			fullStr += "\n" + totalsFooter(localTotals, maxLineSize, verSep, intSep);
 			fullStr += "\n" + extSep;
 			fullStr += "\n" + monthHeader(op.date(), maxIndexSize, maxLineSize, verSep, intSep);
 			// Reset values.
 			currentMonth = op.date().month();
+			currentYear = op.date().year();
 			localTotals = {Amount(0), Amount(0)};
 		}
 		// Add current op amount.
@@ -86,10 +143,19 @@ void Printer::printList(const std::vector<Operation> & operations, long totalCou
 			localTotals.second += op.amount();
 		}
 
-		// Add current operation.
-		const std::string opStr = operationString(op, i, maxIndexSize, maxDescSize, verSep);
-		fullStr += "\n" + opStr;
-		i += 1;
+		// Add current operation, shortening labels wider than the operations measured.
+		fullStr += "\n";
+		if(oid < lookahead || TextUtilities::count(op.label()) <= size_t(maxDescSize)){
+			fullStr += operationString(op, index(oid), maxIndexSize, maxDescSize, verSep);
+		} else {
+			const Operation shortened(op.amount(), shortenLabel(op.label(), size_t(maxDescSize)), op.date());
+			fullStr += operationString(shortened, index(oid), maxIndexSize, maxDescSize, verSep);
+		}
+		// Output by blocks.
+		if(fullStr.size() > listBlockSize){
+			Terminal::outputUnicode(fullStr);
+			fullStr.clear();
+		}
 	}
 
 	// Add final footer and separator.
@@ -99,6 +165,186 @@ void Printer::printList(const std::vector<Operation> & operations, long totalCou
 	Terminal::outputUnicode(fullStr + "\n");
 }
 
+void Printer::printGroups(const std::vector<Grouping::Group> & groups, const std::vector<Grouping::Key> & keys){
+	if(groups.empty()) {
+		Terminal::outputUnicode(Terminal::italic( "Empty list" ) + "\n");
+		return;
+	}
+
+	// Build all cells first to compute column widths.
+	std::vector<std::string> titles;
+	for(const Grouping::Key key : keys){
+		titles.push_back(Grouping::keyName(key));
+	}
+	const size_t keyCount = titles.size();
+	titles.insert(titles.end(), {"Count", "In.", "Out.", "Total", "Min.", "Max.", "Mean"});
+
+	std::vector<std::vector<std::string>> rows;
+	rows.reserve(groups.size());
+	for(const auto & group : groups){
+		std::vector<std::string> row = group.keys;
+		row.insert(row.end(), {
+			std::to_string(group.count),
+			Operation::writeAmount(group.totals.first),
+			Operation::writeAmount(group.totals.second),
+			Operation::writeAmount(group.totals.first + group.totals.second),
+			Operation::writeAmount(group.min),
+			Operation::writeAmount(group.max),
+			Operation::writeAmount(group.mean())
+		});
+		rows.push_back(row);
+	}
+	Terminal::outputUnicode("\n " + Terminal::inverse("Groups: " + std::to_string(groups.size()) + " entries.") + "\n" + tableString(titles, rows, keyCount));
+}
+
+void Printer::printStatistics(const std::vector<std::pair<std::string, Statistics>> & groups, Grouping::Key key, size_t window){
+	if(groups.empty()) {
+		Terminal::outputUnicode(Terminal::italic( "Empty list" ) + "\n");
+		return;
+	}
+	const bool period = Grouping::isPeriod(key);
+	std::vector<std::string> titles = {Grouping::keyName(key), "Count", "Total", "Mean", "Std dev.", "Median", "P90"};
+	if(period){
+		titles.push_back("Avg. " + std::to_string(window));
+	}
+
+	const auto rowFor = [](const std::string & name, const Statistics & stats){
+		return std::vector<std::string>{
+			name, std::to_string(stats.count()), Operation::writeAmount(stats.total()), Operation::writeAmount(stats.mean()),
+			Operation::writeAmount(stats.deviation()), Operation::writeAmount(stats.quantile(0.5)), Operation::writeAmount(stats.quantile(0.9))
+		};
+	};
+
+	std::vector<std::vector<std::string>> rows;
+	rows.reserve(groups.size() + 1);
+	Statistics all;
+	Amount windowTotal = 0;
+	for(size_t gid = 0; gid < groups.size(); ++gid){
+		const Statistics & stats = groups[gid].second;
+		all.merge(stats);
+		rows.push_back(rowFor(groups[gid].first, stats));
+		if(period){
+			// Average of the totals of the last periods.
+			windowTotal += stats.total();
+			if(gid >= window){
+				windowTotal -= groups[gid - window].second.total();
+			}
+			const size_t size = std::min(gid + 1, window);
+			rows.back().push_back(Operation::writeAmount(windowTotal / Amount(size)));
+		}
+	}
+	rows.push_back(rowFor("All", all));
+	if(period){
+		rows.back().push_back(Operation::writeAmount(all.total() / Amount(groups.size())));
+	}
+	Terminal::outputUnicode("\n " + Terminal::inverse("Statistics: " + std::to_string(groups.size()) + " entries.") + "\n" + tableString(titles, rows, 1));
+}
+
+std::string Printer::tableString(const std::vector<std::string> & titles, const std::vector<std::vector<std::string>> & rows, size_t keyCount){
+	std::vector<size_t> widths(titles.size());
+	for(size_t cid = 0; cid < titles.size(); ++cid){
+		widths[cid] = TextUtilities::count(titles[cid]);
+	}
+	for(const auto & row : rows){
+		for(size_t cid = 0; cid < row.size(); ++cid){
+			widths[cid] = std::max(widths[cid], TextUtilities::count(row[cid]));
+		}
+	}
+
+	// Update separating strings.
+	std::string intSep = "";
+	std::string verSep = " ";
+	if(!Terminal::supportsANSI()){
+		intSep = "+";
+		for(const size_t width : widths){
+			intSep += std::string(width + 2, '-') + "+";
+		}
+		verSep = "|";
+	}
+	// Keys are aligned left, values right.
+	const auto rowString = [&](const std::vector<std::string> & row){
+		std::string str = verSep;
+		for(size_t cid = 0; cid < row.size(); ++cid){
+			const std::string cell = cid < keyCount ? TextUtilities::padRight(row[cid], widths[cid], ' ') : TextUtilities::padLeft(row[cid], widths[cid], ' ');
+			str += " " + cell + " " + verSep;
+		}
+		return str;
+	};
+
+	std::string fullStr = intSep + (intSep.empty() ? "" : "\n");
+	fullStr += Terminal::inverse(rowString(titles)) + "\n" + intSep + (intSep.empty() ? "" : "\n");
+	for(const auto & row : rows){
+		fullStr += rowString(row) + "\n";
+	}
+	fullStr += intSep + (intSep.empty() ? "" : "\n");
+	return fullStr;
+}
+
+void Printer::printLabels(const std::vector<std::string> & labels){
+	std::string fullStr;
+	for(const std::string & label : labels){
+		fullStr += label + "\n";
+	}
+	Terminal::outputUnicode(fullStr);
+}
+
+void Printer::printReconciliation(const Reconciler & reconciler, const Listing & list, const std::vector<Operation> & records){
+	// Compute various needed lengths.
+	const int maxIndexSize = std::max(int(std::to_string(list.count()).size()), 1);
+	int maxDescSize = 0;
+	for(const auto & match : reconciler.matched()){
+		maxDescSize = std::max(maxDescSize, int(TextUtilities::count(list.operation(match.operation).label())));
+	}
+	for(const size_t rid : reconciler.missing()){
+		maxDescSize = std::max(maxDescSize, int(TextUtilities::count(records[rid].label())));
+	}
+	for(const long oid : reconciler.unexpected()){
+		maxDescSize = std::max(maxDescSize, int(TextUtilities::count(list.operation(oid).label())));
+	}
+	for(const auto & conflict : reconciler.conflicts()){
+		maxDescSize = std::max(maxDescSize, int(TextUtilities::count(records[conflict.record].label())));
+		for(const long oid : conflict.operations){
+			maxDescSize = std::max(maxDescSize, int(TextUtilities::count(list.operation(oid).label())));
+		}
+	}
+	const std::string verSep = Terminal::supportsANSI() ? " " : "|";
+	const auto header = [](const std::string & title, size_t count){
+		return "\n " + Terminal::inverse(title + ": " + std::to_string(count) + " entries.") + "\n";
+	};
+
+	std::string fullStr;
+	// Matched operations, along with the statement record when it differs.
+	fullStr += header("Matched", reconciler.matched().size());
+	for(const auto & match : reconciler.matched()){
+		const Operation & ope = list.operation(match.operation);
+		const Operation & record = records[match.record];
+		fullStr += operationString(ope, match.operation, maxIndexSize, maxDescSize, verSep);
+		if(record.date().key() != ope.date().key() || record.label() != ope.label()){
+			fullStr += " " + Terminal::dim(record.date().toString(Date::Format::DayMonthYearShort) + " " + record.label());
+		}
+		fullStr += "\n";
+	}
+	// Statement records absent from the listing.
+	fullStr += header("Missing from the listing", reconciler.missing().size());
+	for(const size_t rid : reconciler.missing()){
+		fullStr += operationString(records[rid], "+", maxIndexSize, maxDescSize, verSep) + "\n";
+	}
+	// Operations absent from the statement.
+	fullStr += header("Missing from the statement", reconciler.unexpected().size());
+	for(const long oid : reconciler.unexpected()){
+		fullStr += operationString(list.operation(oid), oid, maxIndexSize, maxDescSize, verSep) + "\n";
+	}
+	// Records with multiple possible operations.
+	fullStr += header("Conflicts", reconciler.conflicts().size());
+	for(const auto & conflict : reconciler.conflicts()){
+		fullStr += operationString(records[conflict.record], "?", maxIndexSize, maxDescSize, verSep) + "\n";
+		for(const long oid : conflict.operations){
+			fullStr += operationString(list.operation(oid), oid, maxIndexSize, maxDescSize, verSep) + "\n";
+		}
+	}
+	Terminal::outputUnicode(fullStr);
+}
+
 std::string Printer::monthHeader(const Date & date, int pad, int length, const std::string & verSep, const std::string & intSep) {
 	static const std::vector<std::string> months = {
 		"January", "February", "Mars", "April", "May", "June", "July", "August", "Septembre", "Octobre", "Novembre", "Decembre"
@@ -124,12 +370,16 @@ std::string Printer::totalsFooter(const Totals & totals, int length, const std::
 }
 
  std::string Printer::operationString(const Operation & op, long index, int pad, int shift, const std::string & verSep) {
+	 return operationString(op, std::to_string(index), pad, shift, verSep);
+ }
+
+ std::string Printer::operationString(const Operation & op, const std::string & index, int pad, int shift, const std::string & verSep) {
 
-	 const std::string dateStr = op.date().toString("%d/%m/%y");
+	 const std::string dateStr = op.date().toString(Date::Format::DayMonthYearShort);
 	 const std::string labelStr = TextUtilities::padRight(op.label(), shift+1, ' ');
 	 const std::string amountStr = Operation::writeAmount(op.amount(), true);
 
 	 const std::string localStr = Terminal::bold(TextUtilities::padLeft(amountStr, 9, ' ')) + " " + verSep + " " + dateStr + " " + verSep + " " + Terminal::italic(labelStr);
-	 const std::string indexStr = TextUtilities::padLeft(std::to_string(index), pad, ' ');
+	 const std::string indexStr = TextUtilities::padLeft(index, pad, ' ');
 	 return verSep + Terminal::dim(indexStr) + verSep + localStr + verSep;
  }
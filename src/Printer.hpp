@@ -2,6 +2,10 @@
 
 #include "Common.hpp"
 #include "Operation.hpp"
+#include "Listing.hpp"
+#include "Reconciler.hpp"
+#include "Grouping.hpp"
+#include "Statistics.hpp"
 #include "system/System.hpp"
 
 
@@ -10,14 +14,63 @@ public:
 
 	static void printList(const std::vector<Operation> & operations, long totalCount);
 
+	/** Print operations that are not necessarily the last ones of the listing.
+	 \param operations the operations to print, in chronological order
+	 \param indices the index of each operation in the listing
+	 \param totalCount the number of operations in the listing
+	 */
+	static void printList(const std::vector<Operation> & operations, const std::vector<long> & indices, long totalCount);
+
+	/** Print a range of operations directly from a listing, without copying them.
+	 \param list the listing
+	 \param first the index of the first operation
+	 \param end the index after the last operation
+	 */
+	static void printList(const Listing & list, long first, long end);
+
 	static void printTotals(const Totals & totals, bool leadingNewline = true);
 
+	static void printGroups(const std::vector<Grouping::Group> & groups, const std::vector<Grouping::Key> & keys);
+
+	/** Print distribution statistics per group, along with a moving average of the totals for periods.
+	 \param groups the statistics of each group, sorted by key
+	 \param key the grouping key
+	 \param window the number of periods in the moving average
+	 */
+	static void printStatistics(const std::vector<std::pair<std::string, Statistics>> & groups, Grouping::Key key, size_t window);
+
+	/** Print labels without decoration, one per line, for shell completion scripts.
+	 \param labels the labels
+	 */
+	static void printLabels(const std::vector<std::string> & labels);
+
+	static void printReconciliation(const Reconciler & reconciler, const Listing & list, const std::vector<Operation> & records);
+
 private:
 
+	/** Render operations and output them by blocks, so that long lists are displayed progressively.
+	 Column widths are computed on a bounded number of operations, longer labels of later operations are shortened.
+	 \param count the number of operations
+	 \param operation retrieve an operation, in chronological order
+	 \param index retrieve the index of an operation in the listing
+	 \param totalCount the number of operations in the listing
+	 */
+	static void printOperations(size_t count, const std::function<const Operation & (size_t)> & operation, const std::function<long(size_t)> & index, long totalCount);
+
 	static std::string monthHeader(const Date & date, int pad, int length, const std::string & verSep, const std::string & intSep);
 
 	static std::string totalsFooter(const Totals & totals, int length, const std::string & verSep, const std::string & intSep);
 
+	/** Build a table with a header line, keys aligned left and values aligned right.
+	 \param titles the column titles
+	 \param rows the cells of each row
+	 \param keyCount the number of key columns, first in each row
+	 \return the table
+	 */
+	static std::string tableString(const std::vector<std::string> & titles, const std::vector<std::vector<std::string>> & rows, size_t keyCount);
+
 	static std::string operationString(const Operation & op, long index, int pad, int shift, const std::string & verSep);
 
+	static std::string operationString(const Operation & op, const std::string & index, int pad, int shift, const std::string & verSep);
+
 };
@@ -0,0 +1,202 @@
+#include "Reconciler.hpp"
+#include "system/TextUtilities.hpp"
+
+#include <unordered_map>
+
+namespace {
+
+	/// Sorted trigrams of a normalized label, with word boundaries.
+	std::vector<uint32_t> trigrams(const std::string & label){
+		const std::string str = " " + TextUtilities::normalize(label) + " ";
+		std::vector<uint32_t> grams;
+		if(str.size() < 3){
+			return grams;
+		}
+		grams.reserve(str.size() - 2);
+		for(size_t cid = 0; cid + 2 < str.size(); ++cid){
+			grams.push_back((uint32_t(uchar(str[cid])) << 16) | (uint32_t(uchar(str[cid + 1])) << 8) | uint32_t(uchar(str[cid + 2])));
+		}
+		std::sort(grams.begin(), grams.end());
+		grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+		return grams;
+	}
+
+	/// Dice coefficient between two sets of trigrams, in [0,1].
+	double similarity(const std::vector<uint32_t> & a, const std::vector<uint32_t> & b){
+		if(a.empty() || b.empty()){
+			return 0.0;
+		}
+		size_t common = 0;
+		auto itA = a.begin();
+		auto itB = b.begin();
+		while(itA != a.end() && itB != b.end()){
+			if(*itA < *itB){
+				++itA;
+			} else if(*itB < *itA){
+				++itB;
+			} else {
+				++common; ++itA; ++itB;
+			}
+		}
+		return 2.0 * double(common) / double(a.size() + b.size());
+	}
+
+	struct Candidate {
+		long day;
+		long operation;
+	};
+}
+
+Reconciler::Reconciler(const Listing & list, int window) : _list(list), _window(std::max(window, 0)) {
+}
+
+void Reconciler::reconcile(const std::vector<Operation> & records){
+	_matched.clear();
+	_missing.clear();
+	_unexpected.clear();
+	_conflicts.clear();
+	if(records.empty()){
+		return;
+	}
+
+	// Process records in chronological order.
+	std::vector<size_t> order(records.size());
+	std::vector<long> recordDays(records.size());
+	for(size_t rid = 0; rid < records.size(); ++rid){
+		order[rid] = rid;
+		recordDays[rid] = records[rid].date().dayNumber();
+	}
+	std::stable_sort(order.begin(), order.end(), [&recordDays](size_t a, size_t b){
+		return recordDays[a] < recordDays[b];
+	});
+	const long firstDay = recordDays[order.front()] - _window;
+	const long lastDay = recordDays[order.back()] + _window;
+
+	// Index operations of the statement period by amount, they are sorted by date.
+	std::unordered_map<Amount, std::vector<Candidate>> candidates;
+	std::vector<long> period;
+	for(long oid = 0; oid < _list.count(); ++oid){
+		const Operation & ope = _list.operation(oid);
+		const long day = ope.date().dayNumber();
+		if(day < firstDay){
+			continue;
+		}
+		if(day > lastDay){
+			break;
+		}
+		candidates[ope.amount()].push_back({day, oid});
+		if(day >= firstDay + _window && day <= lastDay - _window){
+			period.push_back(oid);
+		}
+	}
+
+	std::vector<char> used(size_t(_list.count()), 0);
+	std::unordered_map<long, std::vector<uint32_t>> labelCache;
+	const auto labelTrigrams = [this, &labelCache](long oid) -> const std::vector<uint32_t> & {
+		auto entry = labelCache.find(oid);
+		if(entry == labelCache.end()){
+			entry = labelCache.emplace(oid, trigrams(_list.operation(oid).label())).first;
+		}
+		return entry->second;
+	};
+
+	std::vector<long> options;
+	for(const size_t rid : order){
+		const Operation & record = records[rid];
+		const long day = recordDays[rid];
+		const auto bucket = candidates.find(record.amount());
+		options.clear();
+		if(bucket != candidates.end()){
+			const std::vector<Candidate> & list = bucket->second;
+			auto it = std::lower_bound(list.begin(), list.end(), day - _window, [](const Candidate & c, long d){
+				return c.day < d;
+			});
+			for(; it != list.end() && it->day <= day + _window; ++it){
+				if(!used[it->operation]){
+					options.push_back(it->operation);
+				}
+			}
+		}
+		if(options.empty()){
+			_missing.push_back(rid);
+			continue;
+		}
+		if(options.size() == 1){
+			used[options[0]] = 1;
+			_matched.push_back({rid, options[0]});
+			continue;
+		}
+
+		// Rank by label similarity, then by date distance.
+		const std::vector<uint32_t> recordGrams = trigrams(record.label());
+		std::vector<std::pair<double, long>> scores;
+		scores.reserve(options.size());
+		for(const long oid : options){
+			const double score = similarity(recordGrams, labelTrigrams(oid));
+			const long distance = std::abs(_list.operation(oid).date().dayNumber() - day);
+			// Similarity dominates, distance only breaks ties.
+			scores.emplace_back(score - double(distance) / double(2 * (_window + 1)) * 1e-3, oid);
+		}
+		std::stable_sort(scores.begin(), scores.end(), [](const std::pair<double, long> & a, const std::pair<double, long> & b){
+			return a.first > b.first;
+		});
+		const Operation & best = _list.operation(scores[0].second);
+		const Operation & second = _list.operation(scores[1].second);
+		// Identical operations are interchangeable.
+		const bool equivalent = best.date().key() == second.date().key() && best.label() == second.label();
+		if(equivalent || scores[0].first > scores[1].first + 1e-9){
+			used[scores[0].second] = 1;
+			_matched.push_back({rid, scores[0].second});
+			continue;
+		}
+		// Keep all equally likely operations.
+		Conflict conflict = {rid, {}};
+		for(const auto & score : scores){
+			if(score.first < scores[0].first - 1e-9){
+				break;
+			}
+			conflict.operations.push_back(score.second);
+		}
+		_conflicts.push_back(conflict);
+	}
+
+	// Operations matched with later records can't be part of a conflict anymore,
+	// and a conflict reduced to a single operation is a match.
+	bool resolved = true;
+	while(resolved){
+		resolved = false;
+		for(auto conflict = _conflicts.begin(); conflict != _conflicts.end();){
+			std::vector<long> & operations = conflict->operations;
+			operations.erase(std::remove_if(operations.begin(), operations.end(), [&used](long oid){
+				return used[oid] != 0;
+			}), operations.end());
+			if(operations.size() > 1){
+				++conflict;
+				continue;
+			}
+			if(operations.size() == 1){
+				used[operations[0]] = 1;
+				_matched.push_back({conflict->record, operations[0]});
+			} else {
+				_missing.push_back(conflict->record);
+			}
+			conflict = _conflicts.erase(conflict);
+			resolved = true;
+		}
+	}
+
+	std::vector<char> disputed(size_t(_list.count()), 0);
+	for(const Conflict & conflict : _conflicts){
+		for(const long oid : conflict.operations){
+			disputed[oid] = 1;
+		}
+	}
+
+	// Operations outside of the statement period are not expected in it.
+	for(const long oid : period){
+		if(!used[oid] && !disputed[oid]){
+			_unexpected.push_back(oid);
+		}
+	}
+	std::sort(_missing.begin(), _missing.end());
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Common.hpp"
+#include "Listing.hpp"
+
+/**
+ \brief Match the records of a bank statement with the operations already in a listing.
+ Records and operations are joined on their amount, for dates in a window around the record date.
+ When multiple operations could match a record, the most similar label wins, then the closest date.
+ Each operation is matched at most once, and is removed from conflicts when matched.
+ */
+class Reconciler {
+public:
+
+	/// A statement record and the listing operation it corresponds to.
+	struct Match {
+		size_t record; ///< Index in the records.
+		long operation; ///< Index in the listing.
+	};
+
+	/// A statement record that could correspond to multiple operations.
+	struct Conflict {
+		size_t record; ///< Index in the records.
+		std::vector<long> operations; ///< Indices in the listing.
+	};
+
+	/** Constructor.
+	 \param list the listing
+	 \param window maximum number of days between a record and its operation
+	 */
+	Reconciler(const Listing & list, int window);
+
+	/** Match records with the operations of the listing.
+	 \param records the statement records
+	 */
+	void reconcile(const std::vector<Operation> & records);
+
+	/** \return the records with a corresponding operation */
+	const std::vector<Match> & matched() const { return _matched; }
+
+	/** \return the records with no corresponding operation */
+	const std::vector<size_t> & missing() const { return _missing; }
+
+	/** \return the operations in the statement period that correspond to no record */
+	const std::vector<long> & unexpected() const { return _unexpected; }
+
+	/** \return the records with multiple equally likely operations */
+	const std::vector<Conflict> & conflicts() const { return _conflicts; }
+
+private:
+
+	const Listing & _list;
+	const long _window; ///< Tolerance on dates, in days.
+
+	std::vector<Match> _matched;
+	std::vector<size_t> _missing;
+	std::vector<long> _unexpected;
+	std::vector<Conflict> _conflicts;
+};
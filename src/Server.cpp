@@ -0,0 +1,260 @@
+#include "Server.hpp"
+#include "system/Terminal.hpp"
+
+#include <atomic>
+#include <csignal>
+#include <iostream>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace {
+
+	std::atomic<bool> serverRunning(false);
+
+	void stopServer(int){
+		serverRunning = false;
+	}
+
+	fs::path canonicalPath(const fs::path & path){
+		std::error_code ec;
+		const fs::path canonical = fs::weakly_canonical(path, ec);
+		return ec ? fs::absolute(path) : canonical;
+	}
+
+	fs::path rulesPath(const fs::path & path){
+		fs::path rules = path;
+		rules += ".rules";
+		return rules;
+	}
+
+	// Requests and replies fields are separated by null characters.
+	const char fieldSeparator = '\0';
+
+	std::vector<std::string> splitFields(const std::string & str){
+		std::vector<std::string> fields;
+		std::string::size_type begin = 0;
+		while(begin <= str.size()){
+			std::string::size_type end = str.find(fieldSeparator, begin);
+			if(end == std::string::npos){
+				end = str.size();
+			}
+			fields.emplace_back(str.substr(begin, end - begin));
+			begin = end + 1;
+		}
+		return fields;
+	}
+
+	const char replyDone = '1';
+	const char replyRefused = '0';
+
+	// Limits on requests, commands are only a few tokens long.
+	const size_t maxRequestSize = 4 << 20;
+	const int requestTimeout = 1000; ///< For the whole request, in milliseconds.
+	const int replyTimeout = 60000; ///< In milliseconds, commands on large listings can take a while.
+
+}
+
+Server::Server(const fs::path & path, const fs::path & socketPath) :
+	_path(canonicalPath(path)), _socketPath(socketPath), _listing(path), _watcher(path), _rulesWatcher(rulesPath(_path)) {
+}
+
+bool Server::run(){
+	if(!LocalSocket::supported()){
+		Log::Error() << Log::Server << "Server mode is not supported on this platform." << std::endl;
+		return false;
+	}
+
+	// Don't replace a running server, but clean stale socket files.
+	if(System::itemExists(_socketPath)){
+		LocalSocket probe;
+		if(probe.connect(_socketPath)){
+			Log::Error() << Log::Server << "A server is already listening on " << _socketPath << "." << std::endl;
+			return false;
+		}
+		System::removeItem(_socketPath);
+	}
+
+	LocalSocket listener;
+	if(!listener.listen(_socketPath)){
+		return false;
+	}
+
+	serverRunning = true;
+	std::signal(SIGINT, stopServer);
+	std::signal(SIGTERM, stopServer);
+#ifndef _WIN32
+	// Clients disconnecting early shouldn't stop the server.
+	std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+	const unsigned int workerCount = std::max(2u, std::thread::hardware_concurrency());
+	std::vector<std::thread> workers;
+	for(unsigned int wid = 0; wid < workerCount; ++wid){
+		workers.emplace_back(&Server::work, this);
+	}
+
+	Log::Info() << Log::Server << "Serving " << _path << " on " << _socketPath << "." << std::endl;
+
+	while(serverRunning){
+		// Regularly wake up to check if we should stop.
+		LocalSocket client = listener.accept(250);
+		if(!client.valid()){
+			continue;
+		}
+		{
+			std::lock_guard<std::mutex> lock(_clientsMutex);
+			_clients.push_back(std::move(client));
+		}
+		_clientsCondition.notify_one();
+	}
+
+	_clientsCondition.notify_all();
+	for(auto & worker : workers){
+		worker.join();
+	}
+	listener.close();
+	System::removeItem(_socketPath);
+	Log::Info() << Log::Server << "Server stopped." << std::endl;
+	return true;
+}
+
+void Server::work(){
+	while(true){
+		LocalSocket client;
+		{
+			std::unique_lock<std::mutex> lock(_clientsMutex);
+			_clientsCondition.wait(lock, [this]{
+				return !_clients.empty() || !serverRunning;
+			});
+			if(_clients.empty()){
+				return;
+			}
+			client = std::move(_clients.front());
+			_clients.pop_front();
+		}
+		try {
+			answer(client);
+		} catch(const std::exception & e){
+			Log::Error() << Log::Server << "Unable to answer request: " << e.what() << std::endl;
+		}
+	}
+}
+
+void Server::answer(LocalSocket & client){
+	// Don't let a slow or malicious client hold a worker or exhaust memory.
+	std::string request;
+	if(!client.receive(request, maxRequestSize, requestTimeout)){
+		return;
+	}
+	// Request: listing path, ANSI support, command tokens.
+	const std::vector<std::string> fields = splitFields(request);
+	Command command;
+	if(fields.size() < 3 || fields[0] != _path.string()
+	   || !Command::fromTokens(std::vector<std::string>(fields.begin() + 2, fields.end()), command)){
+		client.send(std::string(1, replyRefused));
+		return;
+	}
+
+	refresh();
+
+	// Reply: logs of the command, output of the command.
+	std::string logs(1, replyDone);
+	std::string output;
+	Terminal::setANSI(fields[1] == "1");
+	Terminal::captureOutput(&output);
+	Log::captureThread(&logs);
+
+	if(command.modifies()){
+		std::unique_lock<std::shared_mutex> lock(_listingMutex);
+		command.run(_listing);
+		// Another program modified the file meanwhile, the command is dropped.
+		if(!_listing.save(_path)){
+			_listing.revert(_path);
+		}
+	} else {
+		std::shared_lock<std::shared_mutex> lock(_listingMutex);
+		command.run(_listing);
+	}
+
+	Log::captureThread(nullptr);
+	Terminal::captureOutput(nullptr);
+	logs += fieldSeparator;
+	client.send(logs + output);
+}
+
+void Server::refresh(){
+	// Consume the events of both files.
+	const bool listingChanged = _watcher.changed();
+	const bool rulesChanged = _rulesWatcher.changed();
+	if(!listingChanged && !rulesChanged){
+		return;
+	}
+	// Our own saves are also reported, but will be detected as unchanged.
+	std::unique_lock<std::shared_mutex> lock(_listingMutex);
+	const Listing::Reload reload = _listing.refresh(_path);
+	if(reload == Listing::Reload::APPEND){
+		Log::Verbose() << Log::Server << "Loaded new operations from " << _path << "." << std::endl;
+	} else if(reload == Listing::Reload::FULL){
+		Log::Verbose() << Log::Server << "Reloaded " << _path << "." << std::endl;
+	} else if(reload == Listing::Reload::RULES){
+		Log::Verbose() << Log::Server << "Reloaded the category rules of " << _path << "." << std::endl;
+	}
+}
+
+bool Server::forward(const fs::path & socketPath, const fs::path & path, const Command & command){
+	if(!LocalSocket::supported() || !System::itemExists(socketPath)){
+		return false;
+	}
+	LocalSocket socket;
+	if(!socket.connect(socketPath)){
+		return false;
+	}
+
+	std::string request = canonicalPath(path).string();
+	request += fieldSeparator;
+	request += Terminal::supportsANSI() ? "1" : "0";
+	for(const std::string & token : command.tokens()){
+		request += fieldSeparator;
+		request += token;
+	}
+
+	if(!socket.send(request)){
+		return false;
+	}
+	std::string reply;
+	if(!socket.receive(reply, UINT32_MAX, replyTimeout) || reply.empty()){
+		// The server might have applied the modification, don't apply it twice.
+		if(command.modifies()){
+			Log::Error() << Log::Server << "No answer from the server, the command might not have been applied." << std::endl;
+			return true;
+		}
+		return false;
+	}
+	const std::string::size_type split = reply.find(fieldSeparator);
+	if(reply[0] != replyDone || split == std::string::npos){
+		return false;
+	}
+	// Warnings and errors raised by the server are shown as if the command ran locally.
+	if(split > 1){
+		Log::sync();
+		std::cerr << reply.substr(1, split - 1) << std::flush;
+	}
+	Terminal::outputUnicode(reply.substr(split + 1));
+	return true;
+}
+
+fs::path Server::defaultSocketPath(){
+	const char * runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+	if(runtimeDir && runtimeDir[0] != '\0'){
+		return fs::path(runtimeDir) / "deben.sock";
+	}
+	std::error_code ec;
+	const fs::path tempDir = fs::temp_directory_path(ec);
+#ifdef _WIN32
+	return tempDir / "deben.sock";
+#else
+	return tempDir / ("deben-" + std::to_string(getuid()) + ".sock");
+#endif
+}
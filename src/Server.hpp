@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Common.hpp"
+#include "Command.hpp"
+#include "Listing.hpp"
+#include "system/LocalSocket.hpp"
+#include "system/FileWatcher.hpp"
+
+#include <shared_mutex>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+/**
+ \brief Keep a listing loaded in memory and answer commands sent by other invocations over a local socket.
+ Read-only commands are run concurrently, commands modifying the listing are serialized and saved immediately.
+ */
+class Server {
+public:
+
+	/** Constructor, loads the listing.
+	 \param path the listing file
+	 \param socketPath the socket file to listen on
+	 */
+	Server(const fs::path & path, const fs::path & socketPath);
+
+	/** Serve requests until the process is interrupted.
+	 \return false if the server couldn't be started
+	 */
+	bool run();
+
+	/** Send a command to a running server and print its output.
+	 \param socketPath the server socket file
+	 \param path the listing file the command applies to
+	 \param command the command to run
+	 \return true if a server was found and answered, false if the command should be run locally
+	 */
+	static bool forward(const fs::path & socketPath, const fs::path & path, const Command & command);
+
+	/** \return the default socket path, in the user runtime directory if available */
+	static fs::path defaultSocketPath();
+
+private:
+
+	/** Process queued connections until the server stops. */
+	void work();
+
+	/** Answer the request of a connected client.
+	 \param client the client socket
+	 */
+	void answer(LocalSocket & client);
+
+	/** Update the listing if it or its category rules have been modified by another process. */
+	void refresh();
+
+	const fs::path _path; ///< The listing file (canonical).
+	const fs::path _socketPath; ///< The socket file.
+
+	Listing _listing; ///< The resident listing.
+	FileWatcher _watcher; ///< Detect external modifications of the file.
+	FileWatcher _rulesWatcher; ///< Detect modifications of the category rules.
+	std::shared_mutex _listingMutex; ///< Readers share the listing, writers are exclusive.
+
+	std::deque<LocalSocket> _clients; ///< Pending connections.
+	std::mutex _clientsMutex; ///< Protect pending connections.
+	std::condition_variable _clientsCondition; ///< Signal new connections to workers.
+};
@@ -0,0 +1,190 @@
+#include "Statistics.hpp"
+#include "system/Profiler.hpp"
+
+#include <unordered_map>
+#include <map>
+
+void RunningStats::add(double value){
+	++_count;
+	const double delta = value - _mean;
+	_mean += delta / double(_count);
+	_m2 += delta * (value - _mean);
+}
+
+void RunningStats::merge(const RunningStats & other){
+	if(other._count == 0){
+		return;
+	}
+	if(_count == 0){
+		*this = other;
+		return;
+	}
+	// Combine partial moments (Chan et al.).
+	const long count = _count + other._count;
+	const double delta = other._mean - _mean;
+	_mean += delta * double(other._count) / double(count);
+	_m2 += other._m2 + delta * delta * double(_count) * double(other._count) / double(count);
+	_count = count;
+}
+
+double RunningStats::variance() const {
+	return _count > 1 ? _m2 / double(_count) : 0.0;
+}
+
+QuantileSketch::QuantileSketch(double compression) : _compression(std::max(compression, 10.0)) {
+}
+
+void QuantileSketch::add(double value){
+	_buffer.push_back({value, 1.0});
+	_min = std::min(_min, value);
+	_max = std::max(_max, value);
+	if(double(_buffer.size()) >= 5.0 * _compression){
+		compress();
+	}
+}
+
+void QuantileSketch::merge(const QuantileSketch & other){
+	other.compress();
+	_buffer.insert(_buffer.end(), other._centroids.begin(), other._centroids.end());
+	_min = std::min(_min, other._min);
+	_max = std::max(_max, other._max);
+	compress();
+}
+
+void QuantileSketch::compress() const {
+	if(_buffer.empty()){
+		return;
+	}
+	_buffer.insert(_buffer.end(), _centroids.begin(), _centroids.end());
+	std::sort(_buffer.begin(), _buffer.end(), [](const Centroid & a, const Centroid & b){
+		return a.mean < b.mean;
+	});
+	double total = 0.0;
+	for(const Centroid & centroid : _buffer){
+		total += centroid.weight;
+	}
+
+	// Scale function, allowing smaller centroids near the extremes.
+	const double pi = 3.14159265358979323846;
+	const auto scale = [this, pi](double q){
+		return _compression / (2.0 * pi) * std::asin(2.0 * std::min(std::max(q, 0.0), 1.0) - 1.0);
+	};
+
+	_centroids.clear();
+	Centroid current = _buffer[0];
+	double before = 0.0;
+	double limit = scale(0.0) + 1.0;
+	for(size_t cid = 1; cid < _buffer.size(); ++cid){
+		const Centroid & next = _buffer[cid];
+		const double q = (before + current.weight + next.weight) / total;
+		if(scale(q) <= limit){
+			// Absorb the next centroid.
+			current.mean += (next.mean - current.mean) * next.weight / (current.weight + next.weight);
+			current.weight += next.weight;
+		} else {
+			before += current.weight;
+			_centroids.push_back(current);
+			limit = scale(before / total) + 1.0;
+			current = next;
+		}
+	}
+	_centroids.push_back(current);
+	_buffer.clear();
+}
+
+double QuantileSketch::quantile(double q) const {
+	compress();
+	if(_centroids.empty()){
+		return 0.0;
+	}
+	if(_centroids.size() == 1){
+		return _centroids[0].mean;
+	}
+	double total = 0.0;
+	for(const Centroid & centroid : _centroids){
+		total += centroid.weight;
+	}
+	const double target = std::min(std::max(q, 0.0), 1.0) * total;
+
+	// Interpolate between centroid centers, using the extremes at both ends.
+	double cumulated = 0.0;
+	double previousMean = _min;
+	double previousPosition = 0.0;
+	for(const Centroid & centroid : _centroids){
+		const double position = cumulated + 0.5 * centroid.weight;
+		if(target <= position){
+			const double span = position - previousPosition;
+			const double t = span > 0.0 ? (target - previousPosition) / span : 0.0;
+			return previousMean + t * (centroid.mean - previousMean);
+		}
+		previousMean = centroid.mean;
+		previousPosition = position;
+		cumulated += centroid.weight;
+	}
+	const double span = total - previousPosition;
+	const double t = span > 0.0 ? (target - previousPosition) / span : 1.0;
+	return previousMean + t * (_max - previousMean);
+}
+
+void Statistics::add(Amount amount){
+	_moments.add(double(amount));
+	_quantiles.add(double(amount));
+	_total += amount;
+}
+
+void Statistics::merge(const Statistics & other){
+	_moments.merge(other._moments);
+	_quantiles.merge(other._quantiles);
+	_total += other._total;
+}
+
+Amount Statistics::mean() const {
+	return Amount(std::llround(_moments.mean()));
+}
+
+Amount Statistics::deviation() const {
+	return Amount(std::llround(std::sqrt(_moments.variance())));
+}
+
+Amount Statistics::quantile(double q) const {
+	return Amount(std::llround(_quantiles.quantile(q)));
+}
+
+std::vector<std::pair<std::string, Statistics>> Statistics::compute(const Listing & list, Grouping::Key key, Operation::Type type, const Filter & filter){
+	Profiler::Scope scope("Statistics");
+	scope.count(size_t(list.count()));
+	using StatisticsMap = std::unordered_map<std::string, Statistics>;
+
+	// Split operations in one block per thread, each processed separately.
+	const long count = list.count();
+	const long threadCount = long(std::max(1u, std::thread::hardware_concurrency()));
+	const long blockCount = std::max(std::min(threadCount, count / 4096), 1l);
+	const long blockSize = (count + blockCount - 1) / blockCount;
+	std::vector<StatisticsMap> partials(blockCount);
+
+	System::forParallel(size_t(blockCount), [&](size_t bid){
+		const long begin = long(bid) * blockSize;
+		const long end = std::min(begin + blockSize, count);
+		StatisticsMap & groups = partials[bid];
+		for(long oid = begin; oid < end; ++oid){
+			const Operation & operation = list.operation(oid);
+			if(operation.type() != type || !filter.matches(operation)){
+				continue;
+			}
+			const Amount amount = type == Operation::Type::In ? operation.amount() : -operation.amount();
+			for(const std::string & value : Grouping::keyValues(operation, key)){
+				groups[value].add(amount);
+			}
+		}
+	});
+
+	// Merge partial statistics, ordered by key.
+	std::map<std::string, Statistics> merged;
+	for(StatisticsMap & groups : partials){
+		for(auto & entry : groups){
+			merged[entry.first].merge(entry.second);
+		}
+		groups.clear();
+	}
+	return std::vector<std::pair<std::string, Statistics>>(merged.begin(), merged.end());
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Common.hpp"
+#include "Listing.hpp"
+#include "Grouping.hpp"
+#include "Filter.hpp"
+
+/**
+ \brief Running count, mean and variance of a series of values, computed in a single pass (Welford's algorithm).
+ Two series can be merged.
+ */
+class RunningStats {
+public:
+
+	void add(double value);
+
+	void merge(const RunningStats & other);
+
+	long count() const { return _count; }
+
+	double mean() const { return _mean; }
+
+	/** \return the population variance */
+	double variance() const;
+
+private:
+	long _count = 0;
+	double _mean = 0.0;
+	double _m2 = 0.0; ///< Sum of squared differences to the mean.
+};
+
+/**
+ \brief Approximation of the distribution of a series of values using a bounded number of weighted centroids (t-digest).
+ Quantiles near the extremes are more precise than near the median. Two sketches can be merged.
+ */
+class QuantileSketch {
+public:
+
+	/** Constructor.
+	 \param compression maximum number of centroids, roughly
+	 */
+	explicit QuantileSketch(double compression = 100.0);
+
+	void add(double value);
+
+	void merge(const QuantileSketch & other);
+
+	/** Estimate a quantile.
+	 \param q the quantile, in [0,1]
+	 \return the estimated value
+	 */
+	double quantile(double q) const;
+
+private:
+
+	struct Centroid {
+		double mean;
+		double weight;
+	};
+
+	/** Merge buffered values with the centroids. */
+	void compress() const;
+
+	mutable std::vector<Centroid> _centroids; ///< Sorted by mean.
+	mutable std::vector<Centroid> _buffer; ///< Values not yet merged.
+	double _compression;
+	double _min = std::numeric_limits<double>::max();
+	double _max = std::numeric_limits<double>::lowest();
+};
+
+/**
+ \brief Distribution statistics of amounts: count, total, mean, deviation and quantiles, with bounded memory.
+ */
+class Statistics {
+public:
+
+	void add(Amount amount);
+
+	void merge(const Statistics & other);
+
+	long count() const { return _moments.count(); }
+
+	Amount total() const { return _total; }
+
+	Amount mean() const;
+
+	Amount deviation() const;
+
+	Amount quantile(double q) const;
+
+	/** Compute the statistics of the incomes or expenses kept by a filter, per group.
+	 Expenses are counted as positive amounts. Operations are processed in parallel, each thread
+	 accumulating its own statistics that are merged at the end.
+	 \param list the listing
+	 \param key the property to group operations by
+	 \param type the kind of operations to consider
+	 \param filter the filter to apply
+	 \return the statistics of each group, sorted by key value
+	 */
+	static std::vector<std::pair<std::string, Statistics>> compute(const Listing & list, Grouping::Key key, Operation::Type type, const Filter & filter);
+
+private:
+	RunningStats _moments;
+	QuantileSketch _quantiles;
+	Amount _total = 0;
+};
@@ -2,22 +2,25 @@
 #include "Strings.hpp"
 #include "Listing.hpp"
 #include "Printer.hpp"
-#include "Grapher.hpp"
+#include "Command.hpp"
+#include "Server.hpp"
+#include "Batch.hpp"
+#include "Importer.hpp"
+#include "DuplicateIndex.hpp"
+#include "Reconciler.hpp"
+#include "Exporter.hpp"
 
 #include "system/Config.hpp"
 #include "system/System.hpp"
 #include "system/TextUtilities.hpp"
 #include "system/Terminal.hpp"
+#include "system/Profiler.hpp"
 
 
 #include <ctime>
 #include <iomanip>
 #include <chrono>
 
-enum class Action {
-	ADD, REMOVE, LIST, TOTAL, GRAPH
-};
-
 class DebenConfig : public Config {
 public:
 	
@@ -50,39 +53,45 @@ public:
 				ascii = true;
 			}
 
-			if(arg.key == "delete" || arg.key == "d") {
-				action = Action::REMOVE;
-				if(!arg.values.empty()){
-					index = stol(arg.values[0]);
-				}
+			if(arg.key == "batch" && !arg.values.empty()) {
+				batch = arg.values[0];
 			}
-			if(arg.key == "list" || arg.key == "l") {
-				action = Action::LIST;
-				if(!arg.values.empty()){
-					count = stol(arg.values[0]);
+			if((arg.key == "import" || arg.key == "i") && !arg.values.empty()) {
+				importPath = arg.values[0];
+				if(arg.values.size() > 1){
+					importFormat = arg.values[1];
 				}
 			}
-
-			if(arg.key == "graph" || arg.key == "g"){
-				action = Action::GRAPH;
-				if(!arg.values.empty()){
-					months = stol(arg.values[0]);
-				}
-				if(arg.values.size() > 1){
-					height = stol(arg.values[1]);
+			if(arg.key == "reconcile" && !arg.values.empty()) {
+				reconcilePath = arg.values[0];
+				for(size_t vid = 1; vid < arg.values.size(); ++vid){
+					if(arg.values[vid] == "apply"){
+						reconcileApply = true;
+					} else {
+						reconcileFormat = arg.values[vid];
+					}
 				}
 			}
-
-			if(arg.key == "add" || arg.key == "a" ) {
-				action = Action::ADD;
-				rawOp = arg.values;
+			if(arg.key == "reconcile-window" && !arg.values.empty()) {
+				reconcileWindow = std::max(std::stoi(arg.values[0]), 0);
+			}
+			if(arg.key == "profile") {
+				profile = true;
 			}
-			// Default "add" action.
-			if(TextUtilities::isNumber(arg.key)){
-				action = Action::ADD;
-				rawOp = arg.values;
-				rawOp.insert(rawOp.begin(), arg.key);
+			if(arg.key == "trace" && !arg.values.empty()) {
+				tracePath = arg.values[0];
 			}
+			if(arg.key == "index") {
+				index = true;
+			}
+			if(arg.key == "serve") {
+				serve = true;
+			}
+			if(arg.key == "socket" && !arg.values.empty()) {
+				socket = arg.values[0];
+			}
+
+			command.parse(arg);
 		}
 
 
@@ -91,25 +100,54 @@ public:
 		registerSection("Operations");
 		registerArgument("add", "a", "Add an operation (--add is optional)", "[+,-]amount 'label' dd[/mm[/YYYY]]");
 		registerArgument("delete", "d", "Remove operation at index i (the last one by default)", "i");
+		registerArgument("import", "i", "Import operations from a bank statement (csv, ofx, qif), another listing (txt) or all files in a directory", "path [format]");
+		registerArgument("skip-duplicates", "", "Skip added or imported operations already in the listing, instead of reporting them");
+		registerArgument("duplicate-window", "", "Maximum number of days between two duplicate operations (0 by default)", "days");
+		registerArgument("reconcile", "", "Match the records of a bank statement with the listing, and add the missing ones if apply is specified", "path [format] [apply]");
+		registerArgument("reconcile-window", "", "Maximum number of days between a record and its operation (3 by default)", "days");
+		registerArgument("index", "", "Save an index of labels next to the listing (<path>.idx), to search and complete without loading it");
+		registerArgument("batch", "", "Run the commands listed in a file (or stdin with -), one per line, and save once", "file|-");
 
 		registerSection("Display");
-		registerArgument("list", "l", "List the last n operations (40 by default)", "n");
+		registerArgument("list", "l", "List the last n operations (40 by default, 0 for all)", "n");
+		registerArgument("offset", "", "Skip the k most recent operations when listing", "k");
+		registerArgument("page", "", "List the p-th page of n operations, the first one being the most recent", "p");
 		registerArgument("graph", "g", "Display a plot of the last n months (12 by default) on a graph of m lines", "n [m]");
+		registerArgument("search", "", "List the last n operations (40 by default, 0 for all) whose label contains a text", "text [n]");
+		registerArgument("complete", "", "Print the n most used labels beginning with a prefix (10 by default), for shell completion", "prefix [n]");
+		registerArgument("top", "", "List the n largest expenses, or incomes (10 expenses by default)", "n [in|out]");
+		registerArgument("stats", "", "Display the distribution of expenses, or incomes, per period, label, tag or category (per month by default)", "[day|week|month|year|label|tag|category] [in|out]");
+		registerArgument("group", "", "Aggregate operations by period and/or label, tags or category (month by default)", "day|week|month|year|label|tag|category...");
+		registerArgument("filter", "", "Only consider operations satisfying conditions on their date, amount, label or category, for list, totals, graph, top, stats and group", "'date>=2023/01 amount<-50 label~\"shop\"'");
+		registerArgument("format", "", "Output results as CSV, JSON or NDJSON instead of tables, for other programs", "text|csv|json|ndjson");
 		registerArgument("no-color", "nc", "Skip text decorations", "n");
 
+		registerSection("Server");
+		registerArgument("serve", "", "Keep the listing loaded and answer other invocations");
+		registerArgument("socket", "", "Socket used to reach the server ($XDG_RUNTIME_DIR/deben.sock by default)", "path");
+
 		registerSection("Infos");
 		registerArgument("version", "v", "Displays the current Deben version.");
 		registerArgument("license", "", "Display the license message.");
+		registerArgument("profile", "", "Print the time spent in each phase to the error output.");
+		registerArgument("trace", "", "Save the phases of each thread in a trace-event file, viewable in Perfetto.", "path");
 		
 	}
 
-	std::vector<std::string> rawOp;
+	Command command;
 	std::string path = "";
-	Action action = Action::TOTAL;
-	long index = -1;
-	long count = 40;
-	long months = 12;
-	long height = 24;
+	std::string batch = "";
+	std::string importPath = "";
+	std::string importFormat = "";
+	std::string reconcilePath = "";
+	std::string reconcileFormat = "";
+	int reconcileWindow = 3;
+	bool reconcileApply = false;
+	fs::path socket = Server::defaultSocketPath();
+	bool serve = false;
+	bool index = false;
+	bool profile = false;
+	std::string tracePath = "";
 	bool ascii = false;
 	// Messages.
 	bool version = false;
@@ -118,6 +156,105 @@ public:
 };
 
 
+bool readStatements(const fs::path & importPath, const std::string & formatName, std::vector<std::vector<Operation>> & files){
+	Importer::Format format = Importer::Format::AUTO;
+	if(!formatName.empty() && !Importer::formatFromString(formatName, format)){
+		Log::Error() << "Unknown import format \"" << formatName << "\"." << std::endl;
+		return false;
+	}
+	// Each file of a directory is imported separately.
+	files.resize(1);
+	if(System::isDirectory(importPath)){
+		return Importer::importDirectory(importPath, format, files);
+	}
+	if(!Importer::importFile(importPath, format, files[0])){
+		Log::Error() << "Unable to import operations from " << importPath << "." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool importOperations(const fs::path & importPath, const std::string & formatName, const fs::path & path, const Command & options){
+	std::vector<std::vector<Operation>> files;
+	if(!readStatements(importPath, formatName, files)){
+		return false;
+	}
+
+	Listing list(path);
+
+	// Look for operations already in the listing, or in a previous file.
+	DuplicateIndex duplicates(list, options.duplicateWindow);
+	size_t duplicateCount = 0;
+	std::vector<Operation> operations;
+	for(std::vector<Operation> & file : files){
+		const auto firstSkipped = std::remove_if(file.begin(), file.end(), [&](const Operation & operation){
+			if(!duplicates.consume(operation)){
+				return false;
+			}
+			DuplicateIndex::report(operation, options.skipDuplicates);
+			++duplicateCount;
+			return options.skipDuplicates;
+		});
+		file.erase(firstSkipped, file.end());
+		// Statements can overlap, compare the next files to this one.
+		if(files.size() > 1){
+			for(const Operation & operation : file){
+				duplicates.insert(operation);
+			}
+		}
+		operations.insert(operations.end(), std::make_move_iterator(file.begin()), std::make_move_iterator(file.end()));
+	}
+	const size_t importCount = operations.size();
+
+	list.addOperations(operations);
+	if(!list.save(path)){
+		return false;
+	}
+
+	Log::Info() << "Imported " << importCount << " operations";
+	if(duplicateCount != 0){
+		Log::Info() << ", " << (options.skipDuplicates ? "skipped " : "including ") << duplicateCount << " duplicates";
+	}
+	Log::Info() << "." << std::endl;
+	Printer::printTotals(list.totals(), false);
+	return true;
+}
+
+bool reconcileOperations(const DebenConfig & config, const fs::path & path){
+	std::vector<std::vector<Operation>> files;
+	if(!readStatements(config.reconcilePath, config.reconcileFormat, files)){
+		return false;
+	}
+	std::vector<Operation> records;
+	for(std::vector<Operation> & file : files){
+		records.insert(records.end(), std::make_move_iterator(file.begin()), std::make_move_iterator(file.end()));
+	}
+
+	Listing list(path);
+	Reconciler reconciler(list, config.reconcileWindow);
+	reconciler.reconcile(records);
+	Printer::printReconciliation(reconciler, list, records);
+
+	Log::Info() << "\n" << reconciler.matched().size() << " matched, " << reconciler.missing().size() << " missing from the listing, "
+		<< reconciler.unexpected().size() << " missing from the statement, " << reconciler.conflicts().size() << " conflicts." << std::endl;
+	if(!config.reconcileApply){
+		return true;
+	}
+	// Add the records missing from the listing, conflicts are left to the user.
+	std::vector<Operation> missing;
+	missing.reserve(reconciler.missing().size());
+	for(const size_t rid : reconciler.missing()){
+		missing.push_back(records[rid]);
+	}
+	list.addOperations(missing);
+	if(!list.save(path)){
+		return false;
+	}
+	Log::Info() << "Added " << reconciler.missing().size() << " operations." << std::endl;
+	Printer::printTotals(list.totals(), false);
+	return true;
+}
+
 int main(int argc, char** argv){
 	setlocale(LC_ALL, "");
 	
@@ -137,33 +274,64 @@ int main(int argc, char** argv){
 	if(config.ascii){
 		Terminal::disableANSI();
 	}
+	// Report timings and save the trace when leaving.
+	const Profiler::Session profiling(config.profile, config.tracePath);
 
 	const fs::path path(config.path);
 
-	Listing list(path);
-
-	if(config.action == Action::LIST){
-		auto ops = list.operations(config.count);
-		auto totals = list.totals();
-		Printer::printList(ops, list.count());
-		Printer::printTotals(totals, false);
+	if(!config.batch.empty()){
+		return Batch::run(config.batch, path) ? 0 : 1;
+	}
+	if(!config.importPath.empty()){
+		return importOperations(config.importPath, config.importFormat, path, config.command) ? 0 : 1;
+	}
+	if(!config.reconcilePath.empty()){
+		return reconcileOperations(config, path) ? 0 : 1;
 	}
-	if(config.action == Action::GRAPH){
-		auto months = list.monthTotals(config.months);
-		Grapher::graphMonths(months, list.totals(), config.height);
+	if(config.index){
+		const Listing list(path);
+		const LabelIndex & index = list.labelIndex();
+		if(!index.save(path)){
+			return 1;
+		}
+		Log::Info() << "Indexed " << index.count() << " operations in " << LabelIndex::indexPath(path) << "." << std::endl;
+		return 0;
 	}
-	if(config.action == Action::REMOVE){
-		list.removeOperation(config.index);
-		Printer::printTotals(list.totals());
+	if(config.serve){
+		Server server(path, config.socket);
+		return server.run() ? 0 : 1;
 	}
-	if(config.action == Action::ADD){
-		list.addOperation(config.rawOp);
-		Printer::printTotals(list.totals());
+	// The filter error has already been reported, don't answer with unfiltered results.
+	if(!config.command.filter.valid()){
+		return 1;
 	}
-	if(config.action == Action::TOTAL){
-		Printer::printTotals(list.totals());
+	// Let a running server answer if there is one.
+	if(Server::forward(config.socket, path, config.command)){
+		return 0;
 	}
 
-	list.save(path);
-	return 0;
+	// Totals don't need to load the operations.
+	if(config.command.action == Action::TOTAL && config.command.filter.empty()){
+		const Totals totals = Listing::streamTotals(path);
+		if(config.command.format != Exporter::Format::TEXT){
+			Exporter(config.command.format).writeTotals(totals);
+		} else {
+			Printer::printTotals(totals);
+		}
+		return 0;
+	}
+	// Searches and completions can use an up to date label index.
+	if(config.command.runFromIndex(path)){
+		return 0;
+	}
+
+	Listing list(path);
+	const bool success = config.command.run(list);
+	const bool saved = list.save(path);
+	// Update an outdated index if there is one.
+	const bool usesIndex = config.command.action == Action::SEARCH || config.command.action == Action::COMPLETE;
+	if(usesIndex && System::isFile(LabelIndex::indexPath(path))){
+		list.labelIndex().save(path);
+	}
+	return success && saved ? 0 : 1;
 }
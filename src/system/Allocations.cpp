@@ -0,0 +1,180 @@
+#include "system/Allocations.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+
+#ifdef _WIN32
+#	include <windows.h>
+#	include <psapi.h>
+#	include <malloc.h>
+#else
+#	include <unistd.h>
+#	include <sys/resource.h>
+#	ifdef __APPLE__
+#		include <malloc/malloc.h>
+#	else
+#		include <malloc.h>
+#	endif
+#endif
+
+#ifdef DEBEN_ALLOC_STATS
+
+namespace {
+
+	// Plain atomics, usable before any static initialization.
+	std::atomic<size_t> allocationCount(0);
+	std::atomic<size_t> allocationBytes(0);
+	std::atomic<long long> liveBytes(0);
+	std::atomic<long long> peakBytes(0);
+
+	size_t blockSize(void * ptr){
+#if defined(_WIN32)
+		return _msize(ptr);
+#elif defined(__APPLE__)
+		return malloc_size(ptr);
+#else
+		return malloc_usable_size(ptr);
+#endif
+	}
+
+	void * allocate(size_t size){
+		void * ptr = std::malloc(size == 0 ? 1 : size);
+		if(ptr == nullptr){
+			return nullptr;
+		}
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		allocationBytes.fetch_add(size, std::memory_order_relaxed);
+		const long long block = (long long)(blockSize(ptr));
+		const long long live = liveBytes.fetch_add(block, std::memory_order_relaxed) + block;
+		long long peak = peakBytes.load(std::memory_order_relaxed);
+		while(live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)){
+		}
+		return ptr;
+	}
+
+	void release(void * ptr){
+		if(ptr == nullptr){
+			return;
+		}
+		liveBytes.fetch_sub((long long)(blockSize(ptr)), std::memory_order_relaxed);
+		std::free(ptr);
+	}
+}
+
+void * operator new(size_t size){
+	void * ptr = allocate(size);
+	if(ptr == nullptr){
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void * operator new[](size_t size){
+	void * ptr = allocate(size);
+	if(ptr == nullptr){
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void * operator new(size_t size, const std::nothrow_t &) noexcept {
+	return allocate(size);
+}
+
+void * operator new[](size_t size, const std::nothrow_t &) noexcept {
+	return allocate(size);
+}
+
+void operator delete(void * ptr) noexcept {
+	release(ptr);
+}
+
+void operator delete[](void * ptr) noexcept {
+	release(ptr);
+}
+
+void operator delete(void * ptr, size_t) noexcept {
+	release(ptr);
+}
+
+void operator delete[](void * ptr, size_t) noexcept {
+	release(ptr);
+}
+
+void operator delete(void * ptr, const std::nothrow_t &) noexcept {
+	release(ptr);
+}
+
+void operator delete[](void * ptr, const std::nothrow_t &) noexcept {
+	release(ptr);
+}
+
+bool Allocations::enabled(){
+	return true;
+}
+
+Allocations::Counters Allocations::current(){
+	Counters counters;
+	counters.count = allocationCount.load(std::memory_order_relaxed);
+	counters.bytes = allocationBytes.load(std::memory_order_relaxed);
+	counters.live = liveBytes.load(std::memory_order_relaxed);
+	counters.peak = peakBytes.load(std::memory_order_relaxed);
+	return counters;
+}
+
+#else
+
+bool Allocations::enabled(){
+	return false;
+}
+
+Allocations::Counters Allocations::current(){
+	return Counters();
+}
+
+#endif
+
+size_t Allocations::residentMemory(){
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))){
+		return size_t(counters.WorkingSetSize);
+	}
+	return 0;
+#elif defined(__APPLE__)
+	// No direct access to the current resident size without Mach calls.
+	return peakResidentMemory();
+#else
+	std::ifstream statm("/proc/self/statm");
+	size_t total = 0;
+	size_t resident = 0;
+	if(!(statm >> total >> resident)){
+		return 0;
+	}
+	return resident * size_t(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+size_t Allocations::peakResidentMemory(){
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))){
+		return size_t(counters.PeakWorkingSetSize);
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) != 0){
+		return 0;
+	}
+#	ifdef __APPLE__
+	// Bytes on macOS.
+	return size_t(usage.ru_maxrss);
+#	else
+	// Kilobytes on Linux.
+	return size_t(usage.ru_maxrss) * 1024;
+#	endif
+#endif
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Common.hpp"
+
+/**
+ \brief Count heap allocations and measure the memory used by the process.
+ Allocations are only counted when built with DEBEN_ALLOC_STATS (premake option alloc-stats),
+ which replaces the global operator new and delete.
+ \ingroup System
+ */
+class Allocations {
+public:
+
+	/// \brief Allocation counters since the program start, for all threads.
+	struct Counters {
+		size_t count = 0; ///< Number of allocations.
+		size_t bytes = 0; ///< Number of bytes requested.
+		long long live = 0; ///< Bytes currently allocated.
+		long long peak = 0; ///< Maximum number of bytes allocated at once.
+	};
+
+	/** \return true if allocations are counted in this build */
+	static bool enabled();
+
+	/** \return the current counters, or zeros if allocations are not counted */
+	static Counters current();
+
+	/** \return the resident memory of the process in bytes, or 0 if unavailable */
+	static size_t residentMemory();
+
+	/** \return the maximum resident memory of the process in bytes, or 0 if unavailable */
+	static size_t peakResidentMemory();
+};
@@ -0,0 +1,73 @@
+#include "system/FileWatcher.hpp"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+FileWatcher::FileWatcher(const fs::path & path) : _path(path) {
+	std::error_code ec;
+	_size = fs::file_size(_path, ec);
+	_time = fs::last_write_time(_path, ec);
+
+#ifdef __linux__
+	_handle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(_handle < 0){
+		return;
+	}
+	// Watch the parent directory, as editors often replace the file instead of writing to it.
+	const fs::path absPath = fs::absolute(_path);
+	_name = absPath.filename().string();
+	const uint32_t mask = IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE;
+	if(inotify_add_watch(_handle, absPath.parent_path().string().c_str(), mask) < 0){
+		Log::Verbose() << "Unable to watch " << _path << ", falling back to polling." << std::endl;
+		close(_handle);
+		_handle = -1;
+	}
+#endif
+}
+
+FileWatcher::~FileWatcher(){
+#ifdef __linux__
+	if(_handle >= 0){
+		close(_handle);
+	}
+#endif
+}
+
+bool FileWatcher::changed(){
+	std::lock_guard<std::mutex> lock(_mutex);
+
+#ifdef __linux__
+	if(_handle >= 0){
+		bool modified = false;
+		alignas(inotify_event) char buffer[4096];
+		while(true){
+			const ssize_t size = read(_handle, buffer, sizeof(buffer));
+			if(size <= 0){
+				break;
+			}
+			// Find events concerning our file.
+			for(ssize_t offset = 0; offset < size;){
+				const inotify_event * event = reinterpret_cast<const inotify_event *>(buffer + offset);
+				if(event->len > 0 && _name == event->name){
+					modified = true;
+				}
+				offset += ssize_t(sizeof(inotify_event) + event->len);
+			}
+		}
+		return modified;
+	}
+#endif
+
+	std::error_code ec;
+	const uintmax_t size = fs::file_size(_path, ec);
+	const fs::file_time_type time = fs::last_write_time(_path, ec);
+	if(size == _size && time == _time){
+		return false;
+	}
+	_size = size;
+	_time = time;
+	return true;
+}
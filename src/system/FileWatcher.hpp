@@ -0,0 +1,43 @@
+#pragma once
+
+#include "system/System.hpp"
+#include "Common.hpp"
+
+#include <mutex>
+
+/**
+ \brief Detect modifications of a file by other processes.
+ Uses inotify on Linux, and compares the file size and modification time on other platforms.
+ \ingroup System
+ */
+class FileWatcher {
+public:
+
+	/** Start watching a file.
+	 \param path the file to watch
+	 */
+	explicit FileWatcher(const fs::path & path);
+
+	/** Destructor. */
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher &) = delete;
+
+	FileWatcher & operator=(const FileWatcher &) = delete;
+
+	/** Check if the file has been modified since the last call, without blocking.
+	 \return true if the file was modified
+	 */
+	bool changed();
+
+private:
+
+	const fs::path _path; ///< The watched file.
+	std::mutex _mutex; ///< Ensure events are consumed by one thread at a time.
+
+	int _handle = -1; ///< The inotify instance, if available.
+	std::string _name; ///< Name of the file in its parent directory.
+
+	uintmax_t _size = 0; ///< Last known file size, when polling.
+	fs::file_time_type _time; ///< Last known modification time, when polling.
+};
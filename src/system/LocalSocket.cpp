@@ -0,0 +1,237 @@
+#include "system/LocalSocket.hpp"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#endif
+
+#include <cstdint>
+#include <chrono>
+#include <algorithm>
+
+#if defined(_WIN32)
+
+LocalSocket::~LocalSocket(){
+}
+
+LocalSocket::LocalSocket(LocalSocket && other) noexcept : _handle(other._handle) {
+	other._handle = -1;
+}
+
+LocalSocket & LocalSocket::operator=(LocalSocket && other) noexcept {
+	std::swap(_handle, other._handle);
+	return *this;
+}
+
+bool LocalSocket::listen(const fs::path &){
+	Log::Error() << Log::Server << "Local sockets are not supported on this platform." << std::endl;
+	return false;
+}
+
+LocalSocket LocalSocket::accept(int){
+	return LocalSocket();
+}
+
+bool LocalSocket::connect(const fs::path &){
+	return false;
+}
+
+bool LocalSocket::send(const std::string &){
+	return false;
+}
+
+bool LocalSocket::receive(std::string &, size_t, int){
+	return false;
+}
+
+bool LocalSocket::valid() const {
+	return false;
+}
+
+void LocalSocket::close(){
+}
+
+bool LocalSocket::supported(){
+	return false;
+}
+
+#else
+
+namespace {
+
+	bool makeAddress(const fs::path & path, sockaddr_un & address){
+		const std::string str = path.string();
+		std::memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if(str.size() >= sizeof(address.sun_path)){
+			Log::Error() << Log::Server << "Socket path " << path << " is too long." << std::endl;
+			return false;
+		}
+		std::memcpy(address.sun_path, str.c_str(), str.size() + 1);
+		return true;
+	}
+
+	bool writeAll(int handle, const char * data, size_t size){
+#ifdef MSG_NOSIGNAL
+		const int flags = MSG_NOSIGNAL;
+#else
+		const int flags = 0;
+#endif
+		while(size > 0){
+			const ssize_t res = ::send(handle, data, size, flags);
+			if(res < 0){
+				if(errno == EINTR){
+					continue;
+				}
+				return false;
+			}
+			data += res;
+			size -= size_t(res);
+		}
+		return true;
+	}
+
+	using Deadline = std::chrono::steady_clock::time_point;
+
+	/// Read exactly size bytes, failing if the deadline is reached first (unless it is null).
+	bool readAll(int handle, char * data, size_t size, const Deadline * deadline){
+		while(size > 0){
+			if(deadline){
+				const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(*deadline - std::chrono::steady_clock::now()).count();
+				if(remaining <= 0){
+					return false;
+				}
+				pollfd desc = {handle, POLLIN, 0};
+				const int ready = ::poll(&desc, 1, int(remaining));
+				if(ready < 0 && errno == EINTR){
+					continue;
+				}
+				if(ready <= 0){
+					return false;
+				}
+			}
+			const ssize_t res = ::recv(handle, data, size, 0);
+			if(res < 0 && errno == EINTR){
+				continue;
+			}
+			if(res <= 0){
+				return false;
+			}
+			data += res;
+			size -= size_t(res);
+		}
+		return true;
+	}
+
+}
+
+LocalSocket::~LocalSocket(){
+	close();
+}
+
+LocalSocket::LocalSocket(LocalSocket && other) noexcept : _handle(other._handle) {
+	other._handle = -1;
+}
+
+LocalSocket & LocalSocket::operator=(LocalSocket && other) noexcept {
+	std::swap(_handle, other._handle);
+	return *this;
+}
+
+bool LocalSocket::listen(const fs::path & path){
+	close();
+	sockaddr_un address;
+	if(!makeAddress(path, address)){
+		return false;
+	}
+	_handle = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if(_handle < 0){
+		Log::Error() << Log::Server << "Unable to create socket: " << std::strerror(errno) << "." << std::endl;
+		return false;
+	}
+	// Only the current user can connect, restrict the socket file from its creation.
+	const mode_t previousMask = ::umask(077);
+	const bool bound = ::bind(_handle, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+	::umask(previousMask);
+	if(!bound || ::listen(_handle, SOMAXCONN) != 0){
+		Log::Error() << Log::Server << "Unable to listen on " << path << ": " << std::strerror(errno) << "." << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+LocalSocket LocalSocket::accept(int timeout){
+	LocalSocket client;
+	pollfd desc = {_handle, POLLIN, 0};
+	if(::poll(&desc, 1, timeout) <= 0){
+		return client;
+	}
+	client._handle = ::accept(_handle, nullptr, nullptr);
+	return client;
+}
+
+bool LocalSocket::connect(const fs::path & path){
+	close();
+	sockaddr_un address;
+	if(!makeAddress(path, address)){
+		return false;
+	}
+	_handle = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if(_handle < 0){
+		return false;
+	}
+#ifdef SO_NOSIGPIPE
+	const int noSigPipe = 1;
+	setsockopt(_handle, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+	if(::connect(_handle, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0){
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool LocalSocket::send(const std::string & message){
+	// Messages are prefixed by their size.
+	const uint32_t size = uint32_t(message.size());
+	return writeAll(_handle, reinterpret_cast<const char *>(&size), sizeof(size))
+		&& writeAll(_handle, message.data(), message.size());
+}
+
+bool LocalSocket::receive(std::string & message, size_t maxSize, int timeout){
+	const Deadline deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout, 0));
+	const Deadline * limit = timeout >= 0 ? &deadline : nullptr;
+	uint32_t size = 0;
+	if(!readAll(_handle, reinterpret_cast<char *>(&size), sizeof(size), limit)){
+		return false;
+	}
+	if(size > maxSize){
+		Log::Error() << Log::Server << "Message of " << size << " bytes rejected, larger than " << maxSize << " bytes." << std::endl;
+		return false;
+	}
+	message.resize(size);
+	return size == 0 || readAll(_handle, &message[0], size, limit);
+}
+
+bool LocalSocket::valid() const {
+	return _handle >= 0;
+}
+
+void LocalSocket::close(){
+	if(_handle >= 0){
+		::close(_handle);
+		_handle = -1;
+	}
+}
+
+bool LocalSocket::supported(){
+	return true;
+}
+
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "system/System.hpp"
+#include "Common.hpp"
+
+#include <cstdint>
+
+/**
+ \brief Local stream socket (Unix domain socket) exchanging length-prefixed messages.
+ \ingroup System
+ */
+class LocalSocket {
+public:
+
+	/** Default constructor, the socket is invalid until listening or connected. */
+	LocalSocket() = default;
+
+	/** Destructor, closes the socket. */
+	~LocalSocket();
+
+	/** Move constructor. */
+	LocalSocket(LocalSocket && other) noexcept;
+
+	/** Move assignment. */
+	LocalSocket & operator=(LocalSocket && other) noexcept;
+
+	LocalSocket(const LocalSocket &) = delete;
+
+	LocalSocket & operator=(const LocalSocket &) = delete;
+
+	/** Create a socket file and listen for incoming connections. The file is only accessible to the current user.
+	 \param path the socket file path
+	 \return true if the socket is listening
+	 */
+	bool listen(const fs::path & path);
+
+	/** Wait for an incoming connection on a listening socket.
+	 \param timeout maximum waiting time in milliseconds
+	 \return the connected socket, invalid if no connection was received
+	 */
+	LocalSocket accept(int timeout);
+
+	/** Connect to a listening socket.
+	 \param path the socket file path
+	 \return true if the connection succeeded
+	 */
+	bool connect(const fs::path & path);
+
+	/** Send a message.
+	 \param message the message content
+	 \return true if the whole message was sent
+	 */
+	bool send(const std::string & message);
+
+	/** Receive a message.
+	 \param message will contain the message content
+	 \param maxSize the maximum size of the message, larger ones are rejected
+	 \param timeout maximum time to receive the whole message in milliseconds, or -1 to wait indefinitely
+	 \return true if a whole message was received
+	 */
+	bool receive(std::string & message, size_t maxSize = UINT32_MAX, int timeout = -1);
+
+	/** \return true if the socket is open */
+	bool valid() const;
+
+	/** Close the socket. */
+	void close();
+
+	/** \return true if local sockets are supported on this platform */
+	static bool supported();
+
+private:
+
+	int _handle = -1; ///< The socket file descriptor.
+};
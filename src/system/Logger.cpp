@@ -3,6 +3,13 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <iomanip>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
 
 #ifdef _WIN32
 #	include <io.h>
@@ -11,18 +18,277 @@
 #	include <unistd.h>
 #endif
 
+/**
+ \brief Write the lines logged by all threads, from a dedicated thread.
+ Each producer thread owns a single-producer single-consumer ring of lines, reused once the thread exits.
+ */
+class LogWriter {
+public:
+
+	/// \brief Complete line waiting to be written.
+	struct Record {
+		Log * log = nullptr;
+		Log::Level level = Log::Level::INFO;
+		std::string text;
+		size_t order = 0; ///< Global logging order, to interleave threads.
+	};
+
+	/// \brief Lines logged by a thread.
+	struct Ring {
+		static const size_t capacity = 1024;
+		Record records[capacity];
+		std::atomic<size_t> head{0}; ///< Next record to write, only advanced by the writer.
+		std::atomic<size_t> tail{0}; ///< Next free record, only advanced by the producer.
+		std::atomic<bool> owned{true}; ///< Is a thread currently producing in this ring.
+	};
+
+	/// \brief Release the ring of a thread when it exits.
+	struct Owner {
+		Ring * ring = nullptr;
+
+		~Owner() {
+			if(ring) {
+				ring->owned = false;
+			}
+		}
+	};
+
+	/** Queue a line, or write it directly once the writer has been stopped.
+	 \param record the line to write
+	 */
+	void push(Record && record) {
+		if(_stopped) {
+			writeDirect(record);
+			return;
+		}
+		Ring & ring = currentRing();
+		const size_t tail = ring.tail.load(std::memory_order_relaxed);
+		// Wait for the writer if the ring is full.
+		if(tail - ring.head.load(std::memory_order_acquire) >= Ring::capacity) {
+			waitWriter([&ring, tail]() {
+				return tail - ring.head.load(std::memory_order_acquire) < Ring::capacity;
+			});
+			if(_stopped) {
+				writeDirect(record);
+				return;
+			}
+		}
+		record.order = _order.fetch_add(1, std::memory_order_relaxed);
+		ring.records[tail % Ring::capacity] = std::move(record);
+		ring.tail.store(tail + 1, std::memory_order_release);
+		// Only take the lock if the writer is waiting. Paired with the fence in run(): either the writer
+		// sees the new line before waiting, or this thread sees that it is waiting.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(_sleeping.load(std::memory_order_relaxed)) {
+			std::lock_guard<std::mutex> lock(_mutex);
+			_pending = true;
+			_cv.notify_one();
+		}
+	}
+
+	/** Wait until all queued lines are written. */
+	void sync() {
+		if(_stopped) {
+			return;
+		}
+		std::vector<std::pair<Ring *, size_t>> targets;
+		for(Ring * ring : rings()) {
+			targets.emplace_back(ring, ring->tail.load(std::memory_order_acquire));
+		}
+		waitWriter([&targets]() {
+			for(const auto & target : targets) {
+				if(target.first->head.load(std::memory_order_acquire) < target.second) {
+					return false;
+				}
+			}
+			return true;
+		});
+	}
+
+	/** Write all queued lines and stop the writer thread, later lines are written directly. */
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if(_stopped) {
+				return;
+			}
+			_stopped = true;
+		}
+		_cv.notify_one();
+		_drainedCv.notify_all();
+		if(_thread.joinable()) {
+			_thread.join();
+		}
+		drain();
+	}
+
+private:
+
+	void writeDirect(const Record & record) {
+		std::lock_guard<std::mutex> lock(_directMutex);
+		record.log->write(record.level, record.text);
+	}
+
+	/** Wake the writer up and wait until it has written enough lines, or has been stopped.
+	 \param done returns true once the expected lines are written
+	 */
+	template<typename Done>
+	void waitWriter(const Done & done) {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_pending = true;
+		_cv.notify_one();
+		_drainedCv.wait(lock, [this, &done]() {
+			return _stopped || done();
+		});
+	}
+
+	/** Check if a line is waiting in a ring, the mutex must be held. */
+	bool hasRecords() const {
+		for(const auto & ring : _rings) {
+			if(ring->head.load(std::memory_order_relaxed) != ring->tail.load(std::memory_order_acquire)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	Ring & currentRing() {
+		thread_local Owner owner;
+		if(owner.ring == nullptr) {
+			std::lock_guard<std::mutex> lock(_mutex);
+			// Reuse a ring left by a finished thread, once it has been written.
+			for(const auto & ring : _rings) {
+				if(!ring->owned && ring->head == ring->tail) {
+					ring->owned = true;
+					owner.ring = ring.get();
+					break;
+				}
+			}
+			if(owner.ring == nullptr) {
+				_rings.emplace_back(new Ring());
+				owner.ring = _rings.back().get();
+			}
+			if(!_thread.joinable()) {
+				_thread = std::thread(&LogWriter::run, this);
+			}
+		}
+		return *owner.ring;
+	}
+
+	std::vector<Ring *> rings() {
+		std::lock_guard<std::mutex> lock(_mutex);
+		std::vector<Ring *> rings;
+		for(const auto & ring : _rings) {
+			rings.push_back(ring.get());
+		}
+		return rings;
+	}
+
+	/** Write the queued lines of all rings, in the order they were logged.
+	 \return true if lines were written
+	 */
+	bool drain() {
+		const std::vector<Ring *> all = rings();
+		bool wrote = false;
+		while(true) {
+			// Pick the oldest line available.
+			Ring * next = nullptr;
+			size_t nextOrder = 0;
+			for(Ring * ring : all) {
+				const size_t head = ring->head.load(std::memory_order_relaxed);
+				if(head == ring->tail.load(std::memory_order_acquire)) {
+					continue;
+				}
+				const size_t order = ring->records[head % Ring::capacity].order;
+				if(next == nullptr || order < nextOrder) {
+					next	  = ring;
+					nextOrder = order;
+				}
+			}
+			if(next == nullptr) {
+				return wrote;
+			}
+			const size_t head = next->head.load(std::memory_order_relaxed);
+			Record & record	  = next->records[head % Ring::capacity];
+			record.log->write(record.level, record.text);
+			record.text.clear();
+			next->head.store(head + 1, std::memory_order_release);
+			wrote = true;
+		}
+	}
+
+	void run() {
+		while(!_stopped) {
+			if(drain()) {
+				// Release the threads waiting for their lines to be written.
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+				}
+				_drainedCv.notify_all();
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(_mutex);
+			_sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			// Lines published before the flag was visible are caught here.
+			if(!hasRecords()) {
+				_cv.wait(lock, [this]() {
+					return _stopped || _pending;
+				});
+			}
+			_sleeping.store(false, std::memory_order_relaxed);
+			_pending = false;
+		}
+	}
+
+	std::mutex _mutex; ///< Protects the list of rings, the thread creation and the writer sleep.
+	std::mutex _directMutex; ///< Serializes direct writes once stopped.
+	std::condition_variable _cv; ///< Wakes the writer up.
+	std::condition_variable _drainedCv; ///< Signaled by the writer after writing lines.
+	std::vector<std::unique_ptr<Ring>> _rings;
+	std::thread _thread;
+	std::atomic<size_t> _order{0};
+	bool _pending = false; ///< Lines are waiting, protected by the mutex.
+	std::atomic<bool> _sleeping{false}; ///< Is the writer waiting for lines.
+	std::atomic<bool> _stopped{false};
+};
+
+namespace {
+
+	LogWriter & writer() {
+		// Created on first use and never destroyed, so that logging works
+		// during the construction and destruction of other static objects.
+		static LogWriter * writer = new LogWriter();
+		return *writer;
+	}
+
+	/// Write all lines and stop the writer thread when the program exits.
+	struct WriterShutdown {
+		~WriterShutdown() {
+			writer().stop();
+		}
+	} writerShutdown;
+}
+
 // We statically initialize the default logger.
 // We don't really care about its exact construction/destruction moments,
 // but we want it to always be created.
 Log * Log::_defaultLogger = new Log();
 
+Log::Line & Log::line() {
+	thread_local Line current;
+	return current;
+}
+
 void Log::set(Level l) {
-	_level		  = l;
-	_appendPrefix = true;
-	if(_level == Level::VERBOSE && !_verbose) {
+	Line & current		 = line();
+	current.level		 = l;
+	current.appendPrefix = true;
+	current.ignore		 = false;
+	if(current.level == Level::VERBOSE && !_verbose) {
 		// In this case, we want to ignore until the next flush.
-		_ignoreUntilFlush = true;
-		_appendPrefix	 = false;
+		current.ignore		 = true;
+		current.appendPrefix = false;
 	}
 }
 
@@ -57,11 +323,17 @@ Log::Log(const std::string & filePath, bool logToStdin, bool verbose) :
 	setFile(filePath, false);
 }
 
+Log::~Log() {
+	writer().sync();
+}
+
 void Log::setFile(const std::string & filePath, bool flushExisting) {
 	if(flushExisting) {
-		_stream << std::endl;
+		line().stream << std::endl;
 		flush();
 	}
+	// The writer thread should not be using the file.
+	writer().sync();
 	if(_file.is_open()) {
 		_file.close();
 	}
@@ -101,67 +373,217 @@ Log & Log::Error() {
 	return *_defaultLogger;
 }
 
+#if DEBEN_LOG_VERBOSE
 Log & Log::Verbose() {
 	_defaultLogger->set(Level::VERBOSE);
 	return *_defaultLogger;
 }
+#else
+Log::Disabled & Log::Verbose() {
+	thread_local Disabled disabled;
+	return disabled;
+}
+#endif
+
+void Log::sync() {
+	writer().sync();
+}
+
+bool Log::captured(const Line & current) {
+	return current.capture && (current.level == Level::WARNING || current.level == Level::ERROR);
+}
+
+void Log::captureThread(std::string * dst) {
+	line().capture = dst;
+}
 
 void Log::flush() {
-	if(!_ignoreUntilFlush) {
-		const std::string finalStr = _stream.str();
+	Line & current = line();
+	if(!current.ignore && captured(current)) {
+		current.capture->append(current.stream.str());
+	} else if(!current.ignore) {
+		LogWriter::Record record;
+		record.log	 = this;
+		record.level = current.level;
+		record.text	 = current.stream.str();
+		writer().push(std::move(record));
+	}
+	current.ignore		 = false;
+	current.appendPrefix = false;
+	current.stream.str(std::string());
+	current.stream.clear();
+	current.level = Level::INFO;
+}
 
-		if(_logToStdOut) {
-			if(_level == Level::INFO || _level == Level::VERBOSE) {
-				std::cout << finalStr << std::flush;
-			} else {
-				std::cerr << finalStr << std::flush;
-			}
-		}
-		if(_file.is_open()) {
-			_file << finalStr << std::flush;
+void Log::write(Level level, const std::string & str) {
+	if(_logToStdOut) {
+		if(level == Level::INFO || level == Level::VERBOSE) {
+			std::cout << str << std::flush;
+		} else {
+			std::cerr << str << std::flush;
 		}
 	}
-	_ignoreUntilFlush = false;
-	_appendPrefix	 = false;
-	_stream.str(std::string());
-	_stream.clear();
-	_level = Level::INFO;
+	if(_file.is_open()) {
+		_file << str << std::flush;
+	}
 }
 
-void Log::appendIfNeeded() {
-	if(_appendPrefix) {
-		_appendPrefix = false;
-		if(_useColors) {
-			_stream << _colorStrings[int(_level)];
+void Log::appendIfNeeded(Line & current) {
+	if(current.appendPrefix) {
+		current.appendPrefix = false;
+		if(_useColors && !captured(current)) {
+			current.stream << _colorStrings[int(current.level)];
 		}
-		_stream << _levelStrings[int(_level)];
+		current.stream << _levelStrings[int(current.level)];
 	}
 }
 
 Log & Log::operator<<(const Domain & domain) {
-
-	if(_appendPrefix && _useColors) {
-		_stream << _colorStrings[int(_level)];
+	Line & current = line();
+	if(current.ignore) {
+		return *this;
+	}
+	if(current.appendPrefix && _useColors && !captured(current)) {
+		current.stream << _colorStrings[int(current.level)];
 	}
-	_stream << "[" << _domainStrings[domain] << "] ";
+	current.stream << "[" << _domainStrings[domain] << "] ";
 
-	if(_appendPrefix) {
-		_stream << _levelStrings[int(_level)];
-		_appendPrefix = false;
+	if(current.appendPrefix) {
+		current.stream << _levelStrings[int(current.level)];
+		current.appendPrefix = false;
 	}
 	return *this;
 }
 
 Log & Log::operator<<(std::ostream & (*modif)(std::ostream &)) {
-	appendIfNeeded();
-
-	modif(_stream);
-
+	Line & current = line();
+	if(!current.ignore) {
+		appendIfNeeded(current);
+		modif(current.stream);
+	}
 	flush();
 	return *this;
 }
 
 Log & Log::operator<<(std::ios_base & (*modif)(std::ios_base &)) {
-	modif(_stream);
+	modif(line().stream);
 	return *this;
 }
+
+namespace {
+
+	struct TraceEvent {
+		const char * name; ///< Event name, or null for an end event.
+		double time; ///< Time since the trace start, in microseconds.
+	};
+
+	struct TraceBuffer {
+		std::vector<TraceEvent> events;
+		std::string name;
+		size_t id;
+	};
+
+	bool traceEnabled = false;
+	std::chrono::steady_clock::time_point traceStart;
+	std::mutex traceMutex;
+	std::vector<std::unique_ptr<TraceBuffer>> traceBuffers; ///< Buffers of all threads that recorded events.
+
+	/// Buffer of the current thread, only registered once it records an event.
+	thread_local TraceBuffer * traceBuffer = nullptr;
+
+	TraceBuffer & currentTraceBuffer() {
+		if(traceBuffer == nullptr) {
+			std::lock_guard<std::mutex> lock(traceMutex);
+			traceBuffers.emplace_back(new TraceBuffer());
+			traceBuffer = traceBuffers.back().get();
+			traceBuffer->id = traceBuffers.size();
+			traceBuffer->name = traceBuffer->id == 1 ? "Main" : ("Thread " + std::to_string(traceBuffer->id));
+		}
+		return *traceBuffer;
+	}
+
+	void writeJSONString(std::ostream & out, const std::string & str) {
+		out << "\"";
+		for(const char c : str) {
+			if(c == '"' || c == '\\') {
+				out << '\\' << c;
+			} else if((unsigned char)(c) < 0x20) {
+				out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec << std::setfill(' ');
+			} else {
+				out << c;
+			}
+		}
+		out << "\"";
+	}
+}
+
+void Log::startTrace() {
+	traceStart = std::chrono::steady_clock::now();
+	traceEnabled = true;
+	// Register the calling thread first.
+	currentTraceBuffer();
+}
+
+bool Log::tracing() {
+	return traceEnabled;
+}
+
+void Log::traceBegin(const char * name) {
+	if(!traceEnabled) {
+		return;
+	}
+	const std::chrono::duration<double, std::micro> time = std::chrono::steady_clock::now() - traceStart;
+	currentTraceBuffer().events.push_back({name, time.count()});
+}
+
+void Log::traceEnd() {
+	if(!traceEnabled) {
+		return;
+	}
+	const std::chrono::duration<double, std::micro> time = std::chrono::steady_clock::now() - traceStart;
+	currentTraceBuffer().events.push_back({nullptr, time.count()});
+}
+
+void Log::traceThread(const std::string & name) {
+	if(!traceEnabled) {
+		return;
+	}
+	currentTraceBuffer().name = name;
+}
+
+bool Log::saveTrace(const std::string & filePath) {
+	traceEnabled = false;
+	std::ofstream file(filePath);
+	if(!file.is_open()) {
+		Log::Error() << "Unable to write trace to \"" << filePath << "\"." << std::endl;
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(traceMutex);
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for(const auto & buffer : traceBuffers) {
+		file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":";
+		writeJSONString(file, buffer->name);
+		file << "}}";
+		first = false;
+		// Match end events with their beginning, so that they have a name.
+		std::vector<const char *> open;
+		for(const TraceEvent & event : buffer->events) {
+			if(event.name == nullptr && open.empty()) {
+				continue;
+			}
+			const char * name = event.name ? event.name : open.back();
+			file << ",\n{\"name\":";
+			writeJSONString(file, name);
+			file << ",\"ph\":\"" << (event.name ? 'B' : 'E') << "\",\"ts\":" << event.time << ",\"pid\":1,\"tid\":" << buffer->id << "}";
+			if(event.name) {
+				open.push_back(event.name);
+			} else {
+				open.pop_back();
+			}
+		}
+	}
+	file << "\n]}\n";
+	return true;
+}
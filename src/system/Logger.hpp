@@ -5,6 +5,11 @@
 #include <sstream>
 #include <vector>
 
+/// Set to 0 to compile verbose logs out, so that their arguments are not even formatted.
+#ifndef DEBEN_LOG_VERBOSE
+#	define DEBEN_LOG_VERBOSE 1
+#endif
+
 // Fix for Windows headers.
 #ifdef ERROR
 #	undef ERROR
@@ -12,6 +17,9 @@
 
 /**
  \brief Provides logging utilities, either to the standard/error output or to a file, with multiple criticality levels.
+ Each thread builds its current line separately, and complete lines are passed through a lock-free ring buffer per thread
+ to a writer thread, so that logging from worker threads is safe and does not wait for the output. A lock is only taken
+ to wake the writer up when it is idle, or when a thread waits for its lines to be written.
  \ingroup System
  */
 class Log {
@@ -43,13 +51,48 @@ private:
 	 */
 	void set(Level l);
 
-	const std::vector<std::string> _domainStrings = {"Load", "Generation", "Upload", "Utilities", "Config", "Password", "SFTP"}; ///< Domain prefix strings.
+	const std::vector<std::string> _domainStrings = {"Load", "Generation", "Upload", "Utilities", "Config", "Password", "Server"}; ///< Domain prefix strings.
 
 	const std::vector<std::string> _levelStrings = {"", "(!) ", "(X) ", ""}; ///< Levels prefix strings.
 
 	const std::vector<std::string> _colorStrings = {"\x1B[0m\x1B[39m", "\x1B[0m\x1B[33m", "\x1B[0m\x1B[31m", "\x1B[2m\x1B[37m"}; ///< Colors prefix strings.
 
+	/// \brief Line being built on a thread.
+	struct Line {
+		std::stringstream stream; ///< Internal log string stream.
+		Level level = Level::INFO; ///< The current criticality level.
+		bool ignore = false; ///< Ignore the current line because it is verbose.
+		bool appendPrefix = false; ///< Should a domain or level prefix be appended to the current line.
+		std::string * capture = nullptr; ///< If set, complete warnings and errors are appended to it instead of being written.
+	};
+
+	/** \return the line being built on the current thread */
+	static Line & line();
+
+	/** \return true if the line should be appended to the capture string of its thread */
+	static bool captured(const Line & current);
+
+	friend class LogWriter;
+
 public:
+
+	/** \brief Stand-in for the loggers of levels compiled out, ignoring all inputs. */
+	class Disabled {
+	public:
+		template<class T>
+		Disabled & operator<<(const T &) {
+			return *this;
+		}
+
+		Disabled & operator<<(std::ostream & (*)(std::ostream &)) {
+			return *this;
+		}
+
+		Disabled & operator<<(std::ios_base & (*)(std::ios_base &)) {
+			return *this;
+		}
+	};
+
 	/** Default constructor, will use standard output */
 	Log();
 
@@ -60,6 +103,9 @@ public:
 	 */
 	Log(const std::string & filePath, bool logToStdin, bool verbose = false);
 
+	/** Destructor, waits for all pending lines to be written. */
+	~Log();
+
 	/** Set the verbosity level.
 	 \param verbose toggle verbosity
 	 */
@@ -71,8 +117,11 @@ public:
 	 */
 	template<class T>
 	Log & operator<<(const T & input) {
-		appendIfNeeded();
-		_stream << input;
+		Line & current = line();
+		if(!current.ignore) {
+			appendIfNeeded(current);
+			current.stream << input;
+		}
 		return *this;
 	}
 
@@ -126,7 +175,55 @@ public:
 	/** The default logger with a verbose level.
 	 \return itself for chaining
 	 */
+#if DEBEN_LOG_VERBOSE
 	static Log & Verbose();
+#else
+	static Disabled & Verbose();
+#endif
+
+	/** Wait until all lines logged so far, from all threads, have been written.
+	 \note Call before writing to the standard outputs directly, to preserve the ordering.
+	 */
+	static void sync();
+
+	/** Redirect the warnings and errors logged by the current thread to a string, without colors, or restore their output.
+	 \param dst the string to append lines to, or null to write them again
+	 */
+	static void captureThread(std::string * dst);
+
+	/** @} */
+
+	/** \name Trace events
+	 Begin and end events are stored in a buffer per thread, without locking, and can be saved
+	 in the Chrome trace-event format, viewable in Perfetto or chrome://tracing.
+	 @{ */
+
+	/** Start recording trace events, from all threads. */
+	static void startTrace();
+
+	/** \return true if trace events are recorded */
+	static bool tracing();
+
+	/** Record the beginning of an event on the current thread.
+	 \param name the event name, should be a string literal
+	 */
+	static void traceBegin(const char * name);
+
+	/** Record the end of the last event begun on the current thread.
+	 */
+	static void traceEnd();
+
+	/** Name the current thread in the trace.
+	 \param name the thread name
+	 */
+	static void traceThread(const std::string & name);
+
+	/** Write all recorded events as a trace-event JSON file, and stop recording.
+	 \param filePath the output file
+	 \return true if the file was written
+	 \warning No other thread should be recording events.
+	 */
+	static bool saveTrace(const std::string & filePath);
 
 	/** @} */
 
@@ -137,21 +234,24 @@ private:
 	 */
 	void setFile(const std::string & filePath, bool flushExisting = true);
 
-	/** Flush the log stream.
+	/** Send the current line to the writer thread.
 	 */
 	void flush();
 
+	/** Write a complete line to the outputs, from the writer thread.
+	 \param level the line criticality level
+	 \param str the line
+	 */
+	void write(Level level, const std::string & str);
+
 	/** Append the current domain/level prefix if it is needed.
+	 \param current the line being built
 	 */
-	void appendIfNeeded();
+	void appendIfNeeded(Line & current);
 
-	Level _level	  = Level::INFO; ///< The current criticality level.
 	bool _logToStdOut = true;		 ///< Should the logs be output to standard output.
 	std::ofstream _file;			 ///< The output log file stream.
-	std::stringstream _stream;		 ///< Internal log string stream.
 	bool _verbose		   = false;  ///< Is the logger verbose.
-	bool _ignoreUntilFlush = false;  ///< Internal flag to ignore the current line if it is verbose.
-	bool _appendPrefix	 = false;  ///< Should a domain or level prefix be appended to the current line.
 	bool _useColors		   = false;  ///< Should color formatting be used.
 
 	static Log * _defaultLogger; ///< Default static logger.
@@ -0,0 +1,227 @@
+#include "system/Profiler.hpp"
+#include "system/Logger.hpp"
+
+#include <mutex>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include <cmath>
+
+namespace {
+
+	struct Phase {
+		const char * name;
+		int parent;
+		long calls;
+		double duration;
+		size_t items;
+		size_t bytes;
+		size_t allocations;
+		size_t allocated; ///< Bytes requested.
+		long long retained; ///< Bytes still allocated at the end of the phase.
+		bool parallel; ///< Was the phase run by worker threads.
+	};
+
+	std::string formatBytes(double value){
+		std::stringstream str;
+		str << std::fixed << std::setprecision(1);
+		if(std::abs(value) >= 1e9){
+			str << value * 1e-9 << " GB";
+		} else if(std::abs(value) >= 1e6){
+			str << value * 1e-6 << " MB";
+		} else if(std::abs(value) >= 1e3){
+			str << value * 1e-3 << " kB";
+		} else {
+			str << value << " B";
+		}
+		return str.str();
+	}
+
+	std::mutex phasesMutex;
+	std::vector<Phase> phases;
+
+	/// Phase currently running on each thread.
+	thread_local int currentPhase = -1;
+	/// Is the thread a worker started from another phase.
+	thread_local bool workerThread = false;
+
+	std::string formatRate(double value, const char * unit){
+		std::stringstream str;
+		str << std::fixed << std::setprecision(1);
+		if(value >= 1e9){
+			str << value * 1e-9 << " G";
+		} else if(value >= 1e6){
+			str << value * 1e-6 << " M";
+		} else if(value >= 1e3){
+			str << value * 1e-3 << " k";
+		} else {
+			str << value << " ";
+		}
+		str << unit;
+		return str.str();
+	}
+
+	void printPhase(std::ostream & out, int phase, int depth, double total){
+		const Phase & p = phases[phase];
+		std::stringstream time;
+		time << std::fixed << std::setprecision(3) << p.duration * 1000.0 << " ms";
+		std::stringstream share;
+		share << std::fixed << std::setprecision(1) << (total > 0.0 ? 100.0 * p.duration / total : 0.0) << "%";
+
+		out << std::left << std::setw(32) << (std::string(2 * depth, ' ') + p.name + (p.parallel ? " *" : "")) << std::right
+			<< std::setw(8) << p.calls << std::setw(14) << time.str() << std::setw(8) << share.str();
+		if(p.items != 0){
+			out << std::setw(12) << p.items << std::setw(14) << formatRate(double(p.items) / std::max(p.duration, 1e-9), "it/s");
+		} else {
+			out << std::setw(26) << "";
+		}
+		if(p.bytes != 0){
+			out << std::setw(12) << formatRate(double(p.bytes), "B") << std::setw(14) << formatRate(double(p.bytes) / std::max(p.duration, 1e-9), "B/s");
+		} else if(Allocations::enabled()){
+			out << std::setw(26) << "";
+		}
+		if(Allocations::enabled()){
+			out << std::setw(10) << p.allocations << std::setw(12) << formatBytes(double(p.allocated)) << std::setw(12) << formatBytes(double(p.retained));
+			if(p.items != 0){
+				out << std::setw(12) << formatBytes(double(p.retained) / double(p.items));
+			}
+		}
+		out << "\n";
+		for(size_t child = size_t(phase) + 1; child < phases.size(); ++child){
+			if(phases[child].parent == phase){
+				printPhase(out, int(child), depth + 1, total);
+			}
+		}
+	}
+}
+
+bool Profiler::_enabled = false;
+
+Profiler::Scope::Scope(const char * name){
+	if(Log::tracing()){
+		Log::traceBegin(name);
+		_traced = true;
+	}
+	if(!_enabled){
+		return;
+	}
+	_parent = currentPhase;
+	_phase = phase(_parent, name);
+	currentPhase = _phase;
+	_allocations = Allocations::current();
+	_start = std::chrono::steady_clock::now();
+}
+
+void Profiler::Scope::count(size_t items, size_t bytes){
+	_items += items;
+	_bytes += bytes;
+}
+
+Profiler::Scope::~Scope(){
+	if(_traced){
+		Log::traceEnd();
+	}
+	if(_phase < 0){
+		return;
+	}
+	const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - _start;
+	Allocations::Counters allocations = Allocations::current();
+	allocations.count -= _allocations.count;
+	allocations.bytes -= _allocations.bytes;
+	allocations.live -= _allocations.live;
+	record(_phase, duration.count(), _items, _bytes, allocations);
+	currentPhase = _parent;
+}
+
+Profiler::Worker::Worker(int parent) : _previous(currentPhase), _previousWorker(workerThread) {
+	currentPhase = parent;
+	workerThread = true;
+}
+
+Profiler::Worker::~Worker(){
+	currentPhase = _previous;
+	workerThread = _previousWorker;
+}
+
+Profiler::Session::Session(bool enable, const std::string & tracePath) : _enabled(enable), _tracePath(tracePath) {
+	Profiler::_enabled = enable;
+	if(!_tracePath.empty()){
+		Log::startTrace();
+	}
+	_start = std::chrono::steady_clock::now();
+}
+
+Profiler::Session::~Session(){
+	if(!_tracePath.empty()){
+		Log::saveTrace(_tracePath);
+	}
+	if(!_enabled){
+		return;
+	}
+	const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - _start;
+	report(duration.count());
+	Profiler::_enabled = false;
+}
+
+bool Profiler::enabled(){
+	return _enabled;
+}
+
+int Profiler::current(){
+	return currentPhase;
+}
+
+int Profiler::phase(int parent, const char * name){
+	std::lock_guard<std::mutex> lock(phasesMutex);
+	for(size_t pid = 0; pid < phases.size(); ++pid){
+		if(phases[pid].parent == parent && std::strcmp(phases[pid].name, name) == 0){
+			return int(pid);
+		}
+	}
+	phases.push_back({name, parent, 0, 0.0, 0, 0, 0, 0, 0, false});
+	return int(phases.size()) - 1;
+}
+
+void Profiler::record(int phase, double duration, size_t items, size_t bytes, const Allocations::Counters & allocations){
+	std::lock_guard<std::mutex> lock(phasesMutex);
+	Phase & p = phases[phase];
+	p.calls += 1;
+	p.duration += duration;
+	p.items += items;
+	p.bytes += bytes;
+	p.allocations += allocations.count;
+	p.allocated += allocations.bytes;
+	p.retained += allocations.live;
+	p.parallel = p.parallel || workerThread;
+}
+
+void Profiler::report(double total){
+	std::lock_guard<std::mutex> lock(phasesMutex);
+	std::stringstream out;
+	out << "\n" << std::left << std::setw(32) << "Phase" << std::right << std::setw(8) << "Calls" << std::setw(14) << "Wall time"
+		<< std::setw(8) << "Share" << std::setw(12) << "Items" << std::setw(14) << "Throughput" << std::setw(12) << "Data" << std::setw(14) << "Bandwidth";
+	if(Allocations::enabled()){
+		out << std::setw(10) << "Allocs" << std::setw(12) << "Allocated" << std::setw(12) << "Retained" << std::setw(12) << "Per item";
+	}
+	out << "\n";
+	for(size_t pid = 0; pid < phases.size(); ++pid){
+		if(phases[pid].parent < 0){
+			printPhase(out, int(pid), 0, total);
+		}
+	}
+	const bool parallel = std::any_of(phases.begin(), phases.end(), [](const Phase & p){
+		return p.parallel;
+	});
+	out << std::left << std::setw(32) << "Total" << std::right << std::setw(8) << "" << std::setw(11) << std::fixed << std::setprecision(3) << total * 1000.0 << " ms\n";
+	if(parallel){
+		out << "* Also run by worker threads, times are summed over threads and can exceed the enclosing phase.\n";
+	}
+	out << "Peak resident memory: " << formatBytes(double(Allocations::peakResidentMemory())) << "\n";
+	if(Allocations::enabled()){
+		const Allocations::Counters counters = Allocations::current();
+		out << "Peak heap memory: " << formatBytes(double(counters.peak)) << ", " << counters.count << " allocations\n";
+	}
+	Log::sync();
+	std::cerr << out.str() << std::flush;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Common.hpp"
+#include "system/Allocations.hpp"
+
+#include <chrono>
+
+/**
+ \brief Measure the time spent in nested phases of the program, along with the amount of data they process.
+ Phases are delimited by Profiler::Scope objects, and merged by name and nesting across calls and threads.
+ Scopes are also recorded as trace events when the logger is tracing.
+ When built with allocation counting, the heap allocations and memory retained by each phase are also reported.
+ When profiling and tracing are disabled, scopes only check flags.
+ \ingroup System
+ */
+class Profiler {
+public:
+
+	/** \brief Time a phase from its creation to its destruction. */
+	class Scope {
+	public:
+
+		/** Start a phase, nested in the current phase of this thread if any.
+		 \param name the phase name, should be a string literal
+		 */
+		explicit Scope(const char * name);
+
+		/** Record amounts processed in this phase.
+		 \param items the number of items processed
+		 \param bytes the number of bytes processed
+		 */
+		void count(size_t items, size_t bytes = 0);
+
+		/** End the phase. */
+		~Scope();
+
+		Scope(const Scope &) = delete;
+		Scope & operator=(const Scope &) = delete;
+
+	private:
+		int _phase = -1; ///< The phase index, or -1 if profiling is disabled.
+		int _parent = -1; ///< The enclosing phase on this thread.
+		bool _traced = false; ///< Was a trace event begun.
+		size_t _items = 0;
+		size_t _bytes = 0;
+		std::chrono::steady_clock::time_point _start;
+		Allocations::Counters _allocations; ///< Allocation counters at the start.
+	};
+
+	/** \brief Nest the phases of a worker thread in the phase of the thread that started it, for its lifetime.
+	 Phases run by workers are marked in the report, as their time is summed over threads. */
+	class Worker {
+	public:
+
+		/** Constructor.
+		 \param parent the phase of the starting thread, from Profiler::current()
+		 */
+		explicit Worker(int parent);
+
+		/** Restore the previous phase of this thread. */
+		~Worker();
+
+		Worker(const Worker &) = delete;
+		Worker & operator=(const Worker &) = delete;
+
+	private:
+		int _previous; ///< The phase of this thread before.
+		bool _previousWorker; ///< Was this thread already a worker.
+	};
+
+	/** \brief Enable profiling and tracing for its lifetime, print a report and save the trace when destroyed. */
+	class Session {
+	public:
+
+		/** Constructor.
+		 \param enable should profiling be enabled
+		 \param tracePath if not empty, record trace events and save them to this file
+		 */
+		Session(bool enable, const std::string & tracePath);
+
+		/** Print the report to the standard error output and save the trace. */
+		~Session();
+
+	private:
+		const bool _enabled;
+		const std::string _tracePath;
+		std::chrono::steady_clock::time_point _start;
+	};
+
+	/** \return true if profiling is enabled */
+	static bool enabled();
+
+	/** \return the phase currently running on this thread, or -1 */
+	static int current();
+
+	/** Print a per-phase breakdown to the standard error output.
+	 \param total the total duration of the session, in seconds
+	 */
+	static void report(double total);
+
+private:
+
+	/** Find or create a phase.
+	 \param parent the parent phase, or -1
+	 \param name the phase name
+	 \return the phase index
+	 */
+	static int phase(int parent, const char * name);
+
+	/** Accumulate the measurements of a phase.
+	 \param phase the phase index
+	 \param duration the elapsed time, in seconds
+	 \param items the number of items processed
+	 \param bytes the number of bytes processed
+	 \param allocations the allocations performed during the phase
+	 */
+	static void record(int phase, double duration, size_t items, size_t bytes, const Allocations::Counters & allocations);
+
+	static bool _enabled;
+};
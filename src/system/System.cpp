@@ -1,4 +1,5 @@
 #include "system/System.hpp"
+#include "system/Profiler.hpp"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -8,6 +9,9 @@
 #include <unistd.h>
 #endif
 
+#include <cstring>
+#include <atomic>
+
 #ifdef _WIN32
 
 std::wstring widen(const std::string & str) {
@@ -149,3 +153,91 @@ bool System::writeStringToFile(const std::string & str, const fs::path & path){
 	file.close();
 	return true;
 }
+
+bool System::forEachLine(const fs::path & path, const std::function<void(const char *, size_t)> & callback, size_t blockSize){
+	std::ifstream file(widen(path.string()), std::ios::binary);
+	if(file.bad() || file.fail()) {
+		Log::Error() << "Unable to load file at path " << path << "." << std::endl;
+		return false;
+	}
+
+	const auto emitLine = [&callback](const char * str, size_t size){
+		// Skip Windows line endings.
+		if(size > 0 && str[size-1] == '\r'){
+			--size;
+		}
+		callback(str, size);
+	};
+
+	std::vector<char> block(std::max(blockSize, size_t(1)));
+	// Storage for lines straddling two blocks, only grows to the longest line size.
+	std::string carry;
+
+	while(file){
+		file.read(block.data(), std::streamsize(block.size()));
+		const size_t readSize = size_t(file.gcount());
+		if(readSize == 0){
+			break;
+		}
+		const char * begin = block.data();
+		const char * end = begin + readSize;
+
+		while(begin != end){
+			const char * lineEnd = static_cast<const char *>(std::memchr(begin, '\n', size_t(end - begin)));
+			if(lineEnd == nullptr){
+				carry.append(begin, end);
+				break;
+			}
+			if(carry.empty()){
+				emitLine(begin, size_t(lineEnd - begin));
+			} else {
+				carry.append(begin, lineEnd);
+				emitLine(carry.data(), carry.size());
+				carry.clear();
+			}
+			begin = lineEnd + 1;
+		}
+	}
+	// Last line with no line ending.
+	if(!carry.empty()){
+		emitLine(carry.data(), carry.size());
+	}
+	return true;
+}
+
+void System::forParallel(size_t count, const std::function<void(size_t)> & task, unsigned int maxThreads){
+	if(maxThreads == 0){
+		maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	const size_t threadCount = std::min(size_t(maxThreads), count);
+	if(threadCount <= 1){
+		for(size_t i = 0; i < count; ++i){
+			task(i);
+		}
+		return;
+	}
+	// Each thread picks the next unprocessed index.
+	std::atomic<size_t> next(0);
+	// Phases of the workers are nested in the current one.
+	const int phase = Profiler::current();
+	const auto worker = [&next, &task, count](){
+		for(size_t i = next++; i < count; i = next++){
+			task(i);
+		}
+	};
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount - 1);
+	for(size_t tid = 1; tid < threadCount; ++tid){
+		threads.emplace_back([&worker, tid, phase](){
+			Profiler::Worker profilerWorker(phase);
+			Log::traceThread("Worker " + std::to_string(tid));
+			Log::traceBegin("Worker");
+			worker();
+			Log::traceEnd();
+		});
+	}
+	worker();
+	for(std::thread & thread : threads){
+		thread.join();
+	}
+}
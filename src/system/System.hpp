@@ -5,6 +5,7 @@
 
 #include <ghc/filesystem.hpp>
 #include <thread>
+#include <functional>
 
 namespace fs = ghc::filesystem;
 
@@ -35,5 +36,21 @@ public:
 	static std::string loadStringFromFile(const fs::path & path);
 	
 	static bool writeStringToFile(const std::string & str, const fs::path & path);
+
+	/** Read a file by fixed-size blocks and call a function on each line, without loading the whole file.
+	 \param path the file to read
+	 \param callback the function to call on each line (without its end of line characters)
+	 \param blockSize the size of the read blocks
+	 \return true if the file could be read
+	 */
+	static bool forEachLine(const fs::path & path, const std::function<void(const char *, size_t)> & callback, size_t blockSize = 65536);
+
+	/** Run a task on each index of a range, spread over a pool of threads. Each index is processed exactly once,
+	 in no particular order, and the call returns once all tasks are complete.
+	 \param count the number of indices
+	 \param task the function to call on each index, from any thread
+	 \param maxThreads maximum number of threads to use, 0 to use all hardware threads
+	 */
+	static void forParallel(size_t count, const std::function<void(size_t)> & task, unsigned int maxThreads = 0);
 	
 };
@@ -1,5 +1,6 @@
 #include "system/Terminal.hpp"
 #include "system/TextUtilities.hpp"
+#include "system/Profiler.hpp"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -11,8 +12,9 @@
 
 #include <iostream>
 
-bool Terminal::_supportChecked = false;
-bool Terminal::_supportANSI = false;
+thread_local bool Terminal::_supportChecked = false;
+thread_local bool Terminal::_supportANSI = false;
+thread_local std::string * Terminal::_capture = nullptr;
 
 bool Terminal::supportsANSI(){
 	if(!_supportChecked){
@@ -57,7 +59,24 @@ void Terminal::disableANSI(){
 
 }
 
+void Terminal::setANSI(bool enable){
+	_supportANSI = enable;
+	_supportChecked = true;
+}
+
+void Terminal::captureOutput(std::string * dst){
+	_capture = dst;
+}
+
 void Terminal::outputUnicode( const std::string& str ) {
+	Profiler::Scope scope("Output");
+	scope.count(0, str.size());
+	if(_capture){
+		_capture->append(str);
+		return;
+	}
+	// Pending log lines go first.
+	Log::sync();
 #ifdef _WIN32
 	const int size = MultiByteToWideChar( CP_UTF8, 0, str.c_str(), -1, nullptr, 0 );
 	WCHAR* arr = new WCHAR[size];
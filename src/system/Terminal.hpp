@@ -15,6 +15,16 @@ public:
 
 	static void disableANSI();
 
+	/** Force ANSI support for the current thread.
+	 \param enable should ANSI modifiers be used
+	 */
+	static void setANSI(bool enable);
+
+	/** Redirect the output of the current thread to a string instead of the standard output.
+	 \param dst the string to append output to, or nullptr to restore the standard output
+	 */
+	static void captureOutput(std::string * dst);
+
 	static void outputUnicode( const std::string& str );
 
 	static std::string black(const std::string & s);
@@ -93,6 +103,7 @@ public:
 
 private:
 
-	static bool _supportChecked;
-	static bool _supportANSI;
+	static thread_local bool _supportChecked;
+	static thread_local bool _supportANSI;
+	static thread_local std::string * _capture;
 };
@@ -1,5 +1,7 @@
 #include "system/TextUtilities.hpp"
 
+#include <cctype>
+
 std::string TextUtilities::trim(const std::string & str, const std::string & del) {
 	const size_t firstNotDel = str.find_first_not_of(del);
 	if(firstNotDel == std::string::npos) {
@@ -37,13 +39,23 @@ std::string TextUtilities::parentDirectory(const std::string & str){
 }
 
 void TextUtilities::replace(std::string & source, const std::string & fromString, const std::string & toString) {
-	std::string::size_type nextPos = 0;
-	const size_t fromSize		   = fromString.size();
-	const size_t toSize			   = toString.size();
-	while((nextPos = source.find(fromString, nextPos)) != std::string::npos) {
-		source.replace(nextPos, fromSize, toString);
-		nextPos += toSize;
+	std::string::size_type nextPos = source.find(fromString);
+	if(fromString.empty() || nextPos == std::string::npos) {
+		return;
 	}
+	// Build the result in one pass, to avoid shifting the end of the string at each occurence.
+	const size_t fromSize		   = fromString.size();
+	std::string result;
+	result.reserve(source.size());
+	std::string::size_type prevPos = 0;
+	while(nextPos != std::string::npos) {
+		result.append(source, prevPos, nextPos - prevPos);
+		result.append(toString);
+		prevPos = nextPos + fromSize;
+		nextPos = source.find(fromString, prevPos);
+	}
+	result.append(source, prevPos, std::string::npos);
+	source.swap(result);
 }
 
 bool TextUtilities::hasPrefix(const std::string & source, const std::string & prefix) {
@@ -100,6 +112,42 @@ std::vector<std::string> TextUtilities::split(const std::string & str, const std
 	return tokens;
 }
 
+std::vector<std::string> TextUtilities::tokenize(const std::string & str){
+	std::vector<std::string> tokens;
+	std::string token;
+	bool inToken = false;
+	char quote = '\0';
+	for(const char c : str){
+		if(quote != '\0'){
+			// Inside quotes, everything is kept until the closing quote.
+			if(c == quote){
+				quote = '\0';
+			} else {
+				token += c;
+			}
+			continue;
+		}
+		if(c == '\'' || c == '"'){
+			quote = c;
+			inToken = true;
+			continue;
+		}
+		if(c == ' ' || c == '\t'){
+			if(inToken){
+				tokens.push_back(token);
+				token.clear();
+				inToken = false;
+			}
+			continue;
+		}
+		token += c;
+		inToken = true;
+	}
+	if(inToken){
+		tokens.push_back(token);
+	}
+	return tokens;
+}
 
 std::string TextUtilities::lowercase(const std::string & src){
 	std::string dst(src);;
@@ -110,13 +158,35 @@ std::string TextUtilities::lowercase(const std::string & src){
 	return dst;
 }
 
+std::string TextUtilities::normalize(const std::string & src){
+	std::string dst;
+	dst.reserve(src.size());
+	for(const char c : src){
+		const unsigned char uc = static_cast<unsigned char>(c);
+		// Keep letters, digits and non-ASCII characters.
+		if(uc >= 0x80){
+			dst += c;
+		} else if(std::isalnum(uc)){
+			dst += char(std::tolower(uc));
+		} else if(!dst.empty() && dst.back() != ' '){
+			dst += ' ';
+		}
+	}
+	if(!dst.empty() && dst.back() == ' '){
+		dst.pop_back();
+	}
+	return dst;
+}
+
 size_t TextUtilities::count(const std::string & s){
 	const char *c_str = s.c_str();
 	size_t strLen = s.length();
 	size_t charCount = 0;
 	size_t u = 0;
 	while(u < strLen){
-		u += size_t(std::mblen(&c_str[u], strLen - u));
+		// Count invalid sequences byte per byte.
+		const int size = std::mblen(&c_str[u], strLen - u);
+		u += size_t(std::max(size, 1));
 		++charCount;
 	}
 	return charCount;
@@ -61,9 +61,21 @@ public:
 	 \return a list of tokens
 	 */
 	static std::vector<std::string> split(const std::string & str, const std::string & delimiter, bool skipEmpty);
+
+	/** Split a command line into tokens separated by spaces, keeping quoted parts together.
+	 \param str the string to split
+	 \return a list of tokens, with quotes removed
+	 */
+	static std::vector<std::string> tokenize(const std::string & str);
 	
 	static std::string lowercase(const std::string & src);
 
+	/** Normalize a string for comparisons: lowercase, with punctuation and repeated spaces removed.
+	 \param src the string to normalize
+	 \return the normalized string
+	 */
+	static std::string normalize(const std::string & src);
+
 	static std::string padLeft(const std::string & s, size_t length, char c);
 	
 	static std::string padRight(const std::string & s, size_t length, char c);